@@ -0,0 +1,506 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+   Growable containers with storage in a @c MemArena.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "swoc/swoc_version.h"
+#include "swoc/MemArena.h"
+#include "swoc/TextView.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+/** A vector with storage in a @c MemArena.
+ *
+ * @tparam T Element type.
+ *
+ * The elements are stored in memory allocated from the arena. When the vector grows it first tries
+ * to extend its storage in place, which succeeds if the storage is the most recent allocation in
+ * the arena and there is free space after it. Otherwise the elements are moved to new storage and
+ * the old storage is abandoned to the arena. The capacity is doubled on growth so the amount of
+ * abandoned memory is at most the final size.
+ *
+ * Memory is never released by the vector, only by the arena. The destructor calls the element
+ * destructors if they are not trivial, therefore the arena must outlive the vector. If the element
+ * type is trivially destructible, destruction of the vector does nothing.
+ */
+template <typename T> class ArenaVector {
+  using self_type = ArenaVector; ///< Self reference type.
+
+public:
+  using value_type     = T;             ///< Element type.
+  using iterator       = T *;           ///< Iterator.
+  using const_iterator = T const *;     ///< Constant iterator.
+
+  /** Construct an empty vector.
+   *
+   * @param arena Source of memory.
+   */
+  explicit ArenaVector(MemArena& arena);
+
+  /// No copying.
+  ArenaVector(self_type const&) = delete;
+  /// No copy assignment.
+  self_type& operator=(self_type const&) = delete;
+
+  /// Move constructor.
+  ArenaVector(self_type&& that);
+
+  /// Destructor.
+  ~ArenaVector();
+
+  /// @return The number of elements.
+  size_t size() const;
+  /// @return The number of elements that can be stored without growing.
+  size_t capacity() const;
+  /// @return @c true if there are no elements.
+  bool empty() const;
+
+  /// @return A pointer to the elements.
+  T *data();
+  /// @return A pointer to the elements.
+  T const *data() const;
+
+  /// @return A span of the elements.
+  MemSpan<T> span();
+  /// @return A span of the elements.
+  MemSpan<T const> span() const;
+
+  /// @return Reference to the element at @a idx.
+  T& operator[](size_t idx);
+  /// @return Reference to the element at @a idx.
+  T const& operator[](size_t idx) const;
+
+  /// @return Reference to the first element.
+  T& front();
+  /// @return Reference to the last element.
+  T& back();
+
+  iterator begin();             ///< Iterator to the first element.
+  iterator end();               ///< Iterator past the last element.
+  const_iterator begin() const; ///< Iterator to the first element.
+  const_iterator end() const;   ///< Iterator past the last element.
+
+  /** Construct an element at the end.
+   *
+   * @param args Constructor arguments.
+   * @return The new element.
+   */
+  template <typename... Args> T& emplace_back(Args&&... args);
+
+  /// Append a copy of @a t.
+  self_type& push_back(T const& t);
+  /// Append @a t.
+  self_type& push_back(T&& t);
+
+  /// Remove the last element.
+  self_type& pop_back();
+
+  /** Ensure capacity.
+   *
+   * @param n Number of elements.
+   * @return @a this
+   */
+  self_type& reserve(size_t n);
+
+  /** Change the number of elements.
+   *
+   * @param n Number of elements.
+   * @return @a this
+   *
+   * New elements are value initialized.
+   */
+  self_type& resize(size_t n);
+
+  /** Remove all elements.
+   *
+   * @return @a this
+   *
+   * The storage is kept for reuse.
+   */
+  self_type& clear();
+
+  /// @return The arena used for storage.
+  MemArena& arena() const;
+
+protected:
+  MemArena *_arena;   ///< Source of memory.
+  T *_data = nullptr; ///< Storage.
+  size_t _count = 0;  ///< Number of elements.
+  size_t _capacity = 0; ///< Number of elements in storage.
+
+  /// Grow the capacity to at least @a n elements.
+  void grow(size_t n);
+
+  /// Capacity to use for at least @a n elements.
+  size_t grow_capacity(size_t n) const;
+
+  /// Try to grow the storage in place to @a n elements.
+  bool grow_in_place(size_t n);
+
+  /// Move the elements to @a span and use it as the storage.
+  void relocate(MemSpan<T> span);
+};
+
+/** A string with storage in a @c MemArena.
+ *
+ * This has the same storage behavior as @c ArenaVector. The text is always followed by a nul
+ * character which is not included in the size.
+ */
+class ArenaString {
+  using self_type = ArenaString; ///< Self reference type.
+
+public:
+  /** Construct an empty string.
+   *
+   * @param arena Source of memory.
+   */
+  explicit ArenaString(MemArena& arena);
+
+  /** Construct with initial text.
+   *
+   * @param arena Source of memory.
+   * @param text Initial text.
+   */
+  ArenaString(MemArena& arena, std::string_view text);
+
+  /// @return The number of characters.
+  size_t size() const;
+  /// @return @c true if there is no text.
+  bool empty() const;
+
+  /// @return A pointer to the nul terminated text.
+  char const *c_str() const;
+  /// @return A pointer to the text.
+  char *data();
+
+  /// @return A view of the text.
+  TextView view() const;
+  /// @return A view of the text.
+  operator TextView() const;
+
+  /// Append @a c.
+  self_type& append(char c);
+  /// Append @a text.
+  self_type& append(std::string_view text);
+  /// Append @a text.
+  self_type& operator+=(std::string_view text);
+  /// Append @a c.
+  self_type& operator+=(char c);
+
+  /// Reserve space for @a n characters.
+  self_type& reserve(size_t n);
+
+  /// Remove all text.
+  self_type& clear();
+
+protected:
+  ArenaVector<char> _text; ///< Text and the terminating nul.
+};
+
+// --- Implementation
+
+template <typename T> ArenaVector<T>::ArenaVector(MemArena& arena) : _arena(&arena) {}
+
+template <typename T>
+ArenaVector<T>::ArenaVector(self_type&& that)
+    : _arena(that._arena), _data(that._data), _count(that._count), _capacity(that._capacity) {
+  that._data     = nullptr;
+  that._count    = 0;
+  that._capacity = 0;
+}
+
+template <typename T> ArenaVector<T>::~ArenaVector() {
+  this->clear();
+}
+
+template <typename T>
+size_t
+ArenaVector<T>::size() const {
+  return _count;
+}
+
+template <typename T>
+size_t
+ArenaVector<T>::capacity() const {
+  return _capacity;
+}
+
+template <typename T>
+bool
+ArenaVector<T>::empty() const {
+  return _count == 0;
+}
+
+template <typename T>
+T *
+ArenaVector<T>::data() {
+  return _data;
+}
+
+template <typename T>
+T const *
+ArenaVector<T>::data() const {
+  return _data;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::span() -> MemSpan<T> {
+  return {_data, _count};
+}
+
+template <typename T>
+auto
+ArenaVector<T>::span() const -> MemSpan<T const> {
+  return {_data, _count};
+}
+
+template <typename T> T& ArenaVector<T>::operator[](size_t idx) {
+  return _data[idx];
+}
+
+template <typename T> T const& ArenaVector<T>::operator[](size_t idx) const {
+  return _data[idx];
+}
+
+template <typename T>
+T&
+ArenaVector<T>::front() {
+  return _data[0];
+}
+
+template <typename T>
+T&
+ArenaVector<T>::back() {
+  return _data[_count - 1];
+}
+
+template <typename T>
+auto
+ArenaVector<T>::begin() -> iterator {
+  return _data;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::end() -> iterator {
+  return _data + _count;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::begin() const -> const_iterator {
+  return _data;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::end() const -> const_iterator {
+  return _data + _count;
+}
+
+template <typename T>
+MemArena&
+ArenaVector<T>::arena() const {
+  return *_arena;
+}
+
+template <typename T>
+size_t
+ArenaVector<T>::grow_capacity(size_t n) const {
+  return std::max(n, 2 * _capacity);
+}
+
+template <typename T>
+bool
+ArenaVector<T>::grow_in_place(size_t n) {
+  if (_capacity && _arena->extend(MemSpan<void>{_data, sizeof(T) * _capacity}, sizeof(T) * n).size()) {
+    _capacity = n;
+    return true;
+  }
+  return false;
+}
+
+template <typename T>
+void
+ArenaVector<T>::relocate(MemSpan<T> span) {
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    if (_count) {
+      std::memcpy(span.data(), _data, sizeof(T) * _count);
+    }
+  } else {
+    std::uninitialized_move(_data, _data + _count, span.data());
+    std::destroy(_data, _data + _count);
+  }
+  _data     = span.data();
+  _capacity = span.count();
+}
+
+template <typename T>
+void
+ArenaVector<T>::grow(size_t n) {
+  n = this->grow_capacity(n);
+  if (!this->grow_in_place(n)) {
+    this->relocate(_arena->alloc_span<T>(n));
+  }
+}
+
+template <typename T>
+template <typename... Args>
+T&
+ArenaVector<T>::emplace_back(Args&&... args) {
+  T *t;
+  if (_count < _capacity) {
+    t = new (_data + _count) T(std::forward<Args>(args)...);
+  } else if (auto n = this->grow_capacity(_count + 1); this->grow_in_place(n)) {
+    t = new (_data + _count) T(std::forward<Args>(args)...);
+  } else {
+    // The arguments may refer to an element, so construct the new element before moving the others.
+    auto span = _arena->alloc_span<T>(n);
+    t         = new (span.data() + _count) T(std::forward<Args>(args)...);
+    this->relocate(span);
+  }
+  ++_count;
+  return *t;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::push_back(T const& t) -> self_type& {
+  this->emplace_back(t);
+  return *this;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::push_back(T&& t) -> self_type& {
+  this->emplace_back(std::move(t));
+  return *this;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::pop_back() -> self_type& {
+  if (_count) {
+    std::destroy_at(_data + --_count);
+  }
+  return *this;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::reserve(size_t n) -> self_type& {
+  if (n > _capacity) {
+    this->grow(n);
+  }
+  return *this;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::resize(size_t n) -> self_type& {
+  if (n < _count) {
+    std::destroy(_data + n, _data + _count);
+  } else if (n > _count) {
+    this->reserve(n);
+    std::uninitialized_value_construct(_data + _count, _data + n);
+  }
+  _count = n;
+  return *this;
+}
+
+template <typename T>
+auto
+ArenaVector<T>::clear() -> self_type& {
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    std::destroy(_data, _data + _count);
+  }
+  _count = 0;
+  return *this;
+}
+
+inline ArenaString::ArenaString(MemArena& arena) : _text(arena) {}
+
+inline ArenaString::ArenaString(MemArena& arena, std::string_view text) : _text(arena) {
+  this->append(text);
+}
+
+inline size_t
+ArenaString::size() const {
+  return _text.empty() ? 0 : _text.size() - 1;
+}
+
+inline bool
+ArenaString::empty() const {
+  return this->size() == 0;
+}
+
+inline char const *
+ArenaString::c_str() const {
+  return _text.empty() ? "" : _text.data();
+}
+
+inline char *
+ArenaString::data() {
+  return _text.data();
+}
+
+inline TextView
+ArenaString::view() const {
+  return {_text.data(), this->size()};
+}
+
+inline ArenaString::operator TextView() const {
+  return this->view();
+}
+
+inline auto
+ArenaString::reserve(size_t n) -> self_type& {
+  _text.reserve(n + 1);
+  return *this;
+}
+
+inline auto
+ArenaString::append(std::string_view text) -> self_type& {
+  auto n = this->size();
+  _text.resize(n + text.size() + 1);
+  if (!text.empty()) {
+    std::memcpy(_text.data() + n, text.data(), text.size());
+  }
+  _text.back() = '\0';
+  return *this;
+}
+
+inline auto
+ArenaString::append(char c) -> self_type& {
+  return this->append(std::string_view{&c, 1});
+}
+
+inline auto
+ArenaString::operator+=(std::string_view text) -> self_type& {
+  return this->append(text);
+}
+
+inline auto
+ArenaString::operator+=(char c) -> self_type& {
+  return this->append(c);
+}
+
+inline auto
+ArenaString::clear() -> self_type& {
+  _text.clear();
+  return *this;
+}
+
+}} // namespace swoc
@@ -54,6 +54,8 @@ protected:
   /** Reallocate the buffer to increase the capacity.
    *
    * @param n Total size required.
+   *
+   * The capacity is at least doubled so that building large output does not repeatedly copy.
    */
   void realloc(size_t n);
 };
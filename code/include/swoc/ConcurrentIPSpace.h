@@ -0,0 +1,438 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+   Concurrent access wrapper for @c IPSpace.
+
+   Readers access an immutable snapshot of the space which is protected by an epoch. Writers
+   modify a private copy of the current snapshot and publish it atomically. Snapshots that have
+   been replaced are reclaimed once no reader can still be using them.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <limits>
+
+#include "swoc/swoc_version.h"
+#include "swoc/swoc_ip.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+/** An @c IPSpace that supports concurrent readers and writers.
+ *
+ * @tparam PAYLOAD Payload type for the space.
+ * @tparam EQUAL Payload equality policy, as for @c IPSpace.
+ *
+ * Reading is done through a @c Reader, which is a per thread handle. A @c Reader provides a
+ * @c Snapshot, which is an immutable view of the space as it was when the snapshot was taken. The
+ * read path has no locks and does not modify any memory shared with other threads - the reader
+ * only writes its own, cache line aligned, epoch slot.
+ *
+ * Writers are serialized. Each update copies the current space, applies the change to the copy,
+ * and then publishes the copy as the current space. Because a copy is made for every update,
+ * updates should be batched via @c update where possible. The replaced space is retired and
+ * destroyed, along with its memory arena, once every reader has left the epoch in which it was
+ * visible.
+ *
+ * @code
+ * ConcurrentIPSpace<unsigned> space;
+ * space.update([&](auto & s) { s.mark(range, 1); s.mark(other, 2); });
+ * // In a reader thread.
+ * auto reader = space.reader();
+ * {
+ *   auto snapshot = reader.snapshot();
+ *   if (auto spot = snapshot->find(addr) ; spot != snapshot->end()) { ... }
+ * }
+ * @endcode
+ */
+template <typename PAYLOAD, typename EQUAL = std::equal_to<PAYLOAD>> class ConcurrentIPSpace {
+  using self_type = ConcurrentIPSpace; ///< Self reference type.
+
+public:
+  using space_type = IPSpace<PAYLOAD, EQUAL>; ///< Underlying space type.
+
+  class Reader;
+  class Snapshot;
+
+  /// Construct an empty space.
+  ConcurrentIPSpace();
+
+  /// No copying.
+  ConcurrentIPSpace(self_type const&) = delete;
+  /// No copy assignment.
+  self_type& operator=(self_type const&) = delete;
+
+  /** Destructor.
+   *
+   * All readers must be destroyed before the space.
+   */
+  ~ConcurrentIPSpace();
+
+  /** Create a reader.
+   *
+   * @return A new reader for @a this.
+   *
+   * A reader is not thread safe and should be used only by a single thread. Each reading thread
+   * should have its own reader. Creating a reader takes the writer lock and is relatively
+   * expensive, so it should be done once per thread and not for each lookup.
+   */
+  Reader reader();
+
+  /** Update the space.
+   *
+   * @tparam F Update functor type.
+   * @param f Update functor.
+   * @return @a this
+   *
+   * @a f must have the signature <tt>void (space_type &)</tt>. It is invoked on a copy of the
+   * current space which is then published as the current space.
+   */
+  template <typename F> self_type& update(F&& f);
+
+  /** Mark the range @a r with @a payload.
+   *
+   * @param range Range to mark.
+   * @param payload Payload to assign.
+   * @return @a this
+   *
+   * @see IPSpace::mark
+   */
+  self_type& mark(IPRange const& range, PAYLOAD const& payload);
+
+  /** Fill the @a range with @a payload.
+   *
+   * @param range Destination range.
+   * @param payload Payload for range.
+   * @return this
+   *
+   * @see IPSpace::fill
+   */
+  self_type& fill(IPRange const& range, PAYLOAD const& payload);
+
+  /** Erase addresses in @a range.
+   *
+   * @param range Address range.
+   * @return @a this
+   *
+   * @see IPSpace::erase
+   */
+  self_type& erase(IPRange const& range);
+
+  /** Blend @a color in to the @a range.
+   *
+   * @tparam F Blending functor type (deduced).
+   * @tparam U Data to blend in to payloads.
+   * @param range Target range.
+   * @param color Data to blend in to existing payloads in @a range.
+   * @param blender Blending functor.
+   * @return @a this
+   *
+   * @see IPSpace::blend
+   */
+  template <typename F, typename U = PAYLOAD> self_type& blend(IPRange const& range, U const& color, F&& blender);
+
+  /// Remove all ranges.
+  self_type& clear();
+
+  /** Destroy retired snapshots that are no longer visible to any reader.
+   *
+   * @return The number of retired snapshots that are still in use.
+   *
+   * This is done automatically on every update, it is needed only to release memory sooner if
+   * there are no further updates.
+   */
+  size_t reclaim();
+
+protected:
+  /// Reader epoch, one per reader.
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> _epoch{0};    ///< Epoch of the active snapshot, 0 if none.
+    std::atomic<bool> _active_p{false}; ///< In use by a reader.
+    Slot *_next = nullptr;              ///< Next slot in the list.
+  };
+
+  /// A space that has been replaced, but may still be visible to readers.
+  struct Retired {
+    uint64_t _epoch;                     ///< Epoch in which the space was replaced.
+    std::unique_ptr<space_type> _space; ///< Replaced space.
+  };
+
+  std::atomic<space_type *> _current{nullptr}; ///< Current snapshot.
+  std::atomic<uint64_t> _epoch{1};             ///< Global epoch.
+  std::mutex _mutex;                           ///< Writer lock.
+  Slot *_slots = nullptr;                      ///< Reader slots, protected by @a _mutex.
+  std::vector<Retired> _retired;               ///< Retired spaces, protected by @a _mutex.
+
+  /// @return A copy of the current space.
+  std::unique_ptr<space_type> copy() const;
+
+  /// Publish @a space as the current space, retiring the previous space.
+  void publish(std::unique_ptr<space_type>&& space);
+
+  /// Reclaim retired spaces, the writer lock must be held.
+  size_t reclaim_locked();
+};
+
+/** Per thread reader handle.
+ *
+ * This provides snapshots of the space. Snapshots may be nested, but must not outlive the reader.
+ */
+template <typename PAYLOAD, typename EQUAL> class ConcurrentIPSpace<PAYLOAD, EQUAL>::Reader {
+  using self_type = Reader; ///< Self reference type.
+  friend ConcurrentIPSpace;
+  friend Snapshot;
+
+public:
+  /// Construct an unattached reader.
+  Reader() = default;
+  /// Move constructor.
+  Reader(self_type&& that);
+  /// Move assignment.
+  self_type& operator=(self_type&& that);
+  /// Release the reader slot.
+  ~Reader();
+
+  /** Take a snapshot of the space.
+   *
+   * @return A snapshot of the current space.
+   *
+   * The snapshot is not affected by later updates and remains valid until it is destroyed.
+   */
+  Snapshot snapshot();
+
+protected:
+  ConcurrentIPSpace *_owner = nullptr; ///< Space being read.
+  Slot *_slot               = nullptr; ///< Epoch slot for this reader.
+  unsigned _depth           = 0;       ///< Number of active snapshots.
+
+  /// Construct a reader for @a owner using @a slot.
+  Reader(ConcurrentIPSpace *owner, Slot *slot) : _owner(owner), _slot(slot) {}
+
+  /// Enter a read side critical section.
+  void enter();
+  /// Leave a read side critical section.
+  void leave();
+  /// Release the slot.
+  void release();
+};
+
+/** Immutable snapshot of the space.
+ *
+ * This provides pointer like access to the constant space.
+ */
+template <typename PAYLOAD, typename EQUAL> class ConcurrentIPSpace<PAYLOAD, EQUAL>::Snapshot {
+  using self_type = Snapshot; ///< Self reference type.
+  friend Reader;
+
+public:
+  /// Move constructor.
+  Snapshot(self_type&& that) : _reader(that._reader), _space(that._space) { that._reader = nullptr; }
+  /// No copying.
+  Snapshot(self_type const&) = delete;
+  /// No assignment.
+  self_type& operator=(self_type const&) = delete;
+
+  /// Release the snapshot.
+  ~Snapshot() {
+    if (_reader) {
+      _reader->leave();
+    }
+  }
+
+  /// @return The space.
+  space_type const& operator*() const { return *_space; }
+  /// @return A pointer to the space.
+  space_type const *operator->() const { return _space; }
+
+protected:
+  Reader *_reader;          ///< Owning reader.
+  space_type const *_space; ///< The space.
+
+  /// Construct for @a reader and @a space.
+  Snapshot(Reader *reader, space_type const *space) : _reader(reader), _space(space) {}
+};
+
+// --- Implementation ---
+
+template <typename PAYLOAD, typename EQUAL> ConcurrentIPSpace<PAYLOAD, EQUAL>::ConcurrentIPSpace() : _current(new space_type) {}
+
+template <typename PAYLOAD, typename EQUAL> ConcurrentIPSpace<PAYLOAD, EQUAL>::~ConcurrentIPSpace() {
+  delete _current.load();
+  while (_slots) {
+    auto slot = _slots;
+    _slots    = slot->_next;
+    delete slot;
+  }
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::reader() -> Reader {
+  std::lock_guard<std::mutex> lock(_mutex);
+  Slot *slot = _slots;
+  while (slot && slot->_active_p.load(std::memory_order_acquire)) {
+    slot = slot->_next;
+  }
+  if (nullptr == slot) {
+    slot        = new Slot;
+    slot->_next = _slots;
+    _slots      = slot;
+  }
+  slot->_active_p.store(true, std::memory_order_relaxed);
+  return Reader{this, slot};
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::copy() const -> std::unique_ptr<space_type> {
+  auto space = std::make_unique<space_type>();
+  // The ranges are sorted and disjoint so this is linear.
+  typename space_type::Loader loader{*space};
+  for (auto const& [range, payload] : *_current.load(std::memory_order_relaxed)) {
+    loader.mark(range, payload);
+  }
+  loader.load();
+  return space;
+}
+
+template <typename PAYLOAD, typename EQUAL>
+void
+ConcurrentIPSpace<PAYLOAD, EQUAL>::publish(std::unique_ptr<space_type>&& space) {
+  auto prev = _current.exchange(space.release(), std::memory_order_seq_cst);
+  // Any reader that sees an epoch later than this also sees the new space.
+  auto epoch = _epoch.fetch_add(1, std::memory_order_seq_cst);
+  _retired.push_back(Retired{epoch, std::unique_ptr<space_type>(prev)});
+  this->reclaim_locked();
+}
+
+template <typename PAYLOAD, typename EQUAL>
+size_t
+ConcurrentIPSpace<PAYLOAD, EQUAL>::reclaim_locked() {
+  auto min = std::numeric_limits<uint64_t>::max();
+  for (auto slot = _slots; slot; slot = slot->_next) {
+    if (auto epoch = slot->_epoch.load(std::memory_order_seq_cst); epoch && epoch < min) {
+      min = epoch;
+    }
+  }
+  // A space retired in epoch E can be seen only by readers in epoch E or earlier.
+  auto spot = std::remove_if(_retired.begin(), _retired.end(), [=](Retired const& r) { return r._epoch < min; });
+  _retired.erase(spot, _retired.end());
+  return _retired.size();
+}
+
+template <typename PAYLOAD, typename EQUAL>
+size_t
+ConcurrentIPSpace<PAYLOAD, EQUAL>::reclaim() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return this->reclaim_locked();
+}
+
+template <typename PAYLOAD, typename EQUAL>
+template <typename F>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::update(F&& f) -> self_type& {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto space = this->copy();
+  f(*space);
+  this->publish(std::move(space));
+  return *this;
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::mark(IPRange const& range, PAYLOAD const& payload) -> self_type& {
+  return this->update([&](space_type& space) { space.mark(range, payload); });
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::fill(IPRange const& range, PAYLOAD const& payload) -> self_type& {
+  return this->update([&](space_type& space) { space.fill(range, payload); });
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::erase(IPRange const& range) -> self_type& {
+  return this->update([&](space_type& space) { space.erase(range); });
+}
+
+template <typename PAYLOAD, typename EQUAL>
+template <typename F, typename U>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::blend(IPRange const& range, U const& color, F&& blender) -> self_type& {
+  return this->update([&](space_type& space) { space.blend(range, color, blender); });
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::clear() -> self_type& {
+  std::lock_guard<std::mutex> lock(_mutex);
+  this->publish(std::make_unique<space_type>());
+  return *this;
+}
+
+template <typename PAYLOAD, typename EQUAL> ConcurrentIPSpace<PAYLOAD, EQUAL>::Reader::Reader(self_type&& that) : _owner(that._owner), _slot(that._slot), _depth(that._depth) {
+  that._owner = nullptr;
+  that._slot  = nullptr;
+  that._depth = 0;
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::Reader::operator=(self_type&& that) -> self_type& {
+  if (this != &that) {
+    this->release();
+    std::swap(_owner, that._owner);
+    std::swap(_slot, that._slot);
+    std::swap(_depth, that._depth);
+  }
+  return *this;
+}
+
+template <typename PAYLOAD, typename EQUAL> ConcurrentIPSpace<PAYLOAD, EQUAL>::Reader::~Reader() {
+  this->release();
+}
+
+template <typename PAYLOAD, typename EQUAL>
+void
+ConcurrentIPSpace<PAYLOAD, EQUAL>::Reader::release() {
+  if (_slot) {
+    _slot->_epoch.store(0, std::memory_order_release);
+    _slot->_active_p.store(false, std::memory_order_release);
+    _slot  = nullptr;
+    _owner = nullptr;
+    _depth = 0;
+  }
+}
+
+template <typename PAYLOAD, typename EQUAL>
+void
+ConcurrentIPSpace<PAYLOAD, EQUAL>::Reader::enter() {
+  if (0 == _depth++) {
+    _slot->_epoch.store(_owner->_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    // The epoch must be visible to writers before the current space is loaded.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+template <typename PAYLOAD, typename EQUAL>
+void
+ConcurrentIPSpace<PAYLOAD, EQUAL>::Reader::leave() {
+  if (0 == --_depth) {
+    _slot->_epoch.store(0, std::memory_order_release);
+  }
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+ConcurrentIPSpace<PAYLOAD, EQUAL>::Reader::snapshot() -> Snapshot {
+  this->enter();
+  return Snapshot{this, _owner->_current.load(std::memory_order_acquire)};
+}
+
+}} // namespace swoc
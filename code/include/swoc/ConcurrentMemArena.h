@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+   Memory arena shared between threads.
+
+   Each thread allocates from its own @c MemArena so that allocation does not need a lock. All of
+   the per thread arenas share a single lifetime and are frozen, thawed, and cleared together.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "swoc/swoc_version.h"
+#include "swoc/MemArena.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+/** A memory arena that can be used by multiple threads.
+ *
+ * Every thread that allocates from the arena gets a private @c MemArena, a "slot", the first time
+ * it allocates. After that the slot is found through a thread local cache, so the allocation fast
+ * path has no locks and does not touch memory shared with other threads.
+ *
+ * Allocation (@c alloc, @c alloc_span, @c make, @c local) is thread safe. The operations that
+ * affect the arena as a whole (@c freeze, @c thaw, @c clear, and the size and @c contains
+ * queries) are not, and must not be done while any thread is allocating. These treat all of the
+ * slots as a single arena, e.g. a freeze makes a single generation from all of the slots.
+ *
+ * @code
+ * ConcurrentMemArena arena;
+ * std::vector<std::thread> workers;
+ * for (auto const& file : files) {
+ *   workers.emplace_back([&] { parse(file, arena); }); // parse calls arena.make<...>(...)
+ * }
+ * for (auto& t : workers) { t.join(); }
+ * @endcode
+ */
+class ConcurrentMemArena {
+  using self_type = ConcurrentMemArena; ///< Self reference type.
+
+public:
+  /** Construct with reservation hint.
+   *
+   * @param n Minimum number of available bytes in the first block of each thread.
+   *
+   * If @a n is zero the @c MemArena default is used.
+   */
+  explicit ConcurrentMemArena(size_t n = 0);
+
+  /** Construct with a block provider and reservation hint.
+   *
+   * @param provider Source of memory for internal blocks.
+   * @param n Minimum number of available bytes in the first block of each thread.
+   *
+   * @a provider is used by all threads and therefore must be thread safe. If @a n is zero the
+   * @c MemArena default is used.
+   */
+  explicit ConcurrentMemArena(MemArena::BlockProvider& provider, size_t n = 0);
+
+  /// No copying.
+  ConcurrentMemArena(self_type const&) = delete;
+  /// No copy assignment.
+  self_type& operator=(self_type const&) = delete;
+
+  /// Destructor.
+  ~ConcurrentMemArena() = default;
+
+  /** Allocate @a n bytes of storage.
+   *
+   * @param n Number of bytes.
+   * @param align Alignment of the allocated memory, which must be a power of 2.
+   * @return The allocated memory.
+   */
+  MemSpan<void> alloc(size_t n, size_t align = 1);
+
+  /** Allocate memory for @a n instances of @a T.
+   *
+   * @tparam T Element type.
+   * @param n Number of instances.
+   * @return The allocated memory.
+   *
+   * @see MemArena::alloc_span
+   */
+  template <typename T> MemSpan<T> alloc_span(size_t n);
+
+  /** Allocate and construct an instance of @a T.
+   *
+   * @tparam T Type to construct.
+   * @param args Constructor arguments.
+   * @return The new instance.
+   *
+   * @see MemArena::make
+   */
+  template <typename T, typename... Args> T *make(Args&&... args);
+
+  /** The arena for the calling thread.
+   *
+   * @return The private arena for the calling thread.
+   *
+   * This can be used for operations that are not otherwise available, such as @c require and
+   * @c remnant. Memory allocated from the local arena belongs to @a this. The local arena must not
+   * be frozen, thawed, or cleared directly.
+   */
+  MemArena& local();
+
+  /** Freeze reserved memory in all threads.
+   *
+   * @param n Target number of available bytes in the next block in each thread.
+   * @return @a this
+   *
+   * @see MemArena::freeze
+   */
+  self_type& freeze(size_t n = 0);
+
+  /** Release the frozen memory in all threads.
+   *
+   * @return @a this
+   *
+   * @see MemArena::thaw
+   */
+  self_type& thaw();
+
+  /** Release all memory in all threads.
+   *
+   * @return @a this
+   *
+   * @see MemArena::clear
+   */
+  self_type& clear();
+
+  /// @return The amount of memory allocated in the active generation.
+  size_t size() const;
+
+  /// @return The total number of bytes allocated.
+  size_t allocated_size() const;
+
+  /// @return Total memory footprint, including wasted space.
+  size_t reserved_size() const;
+
+  /** Check if the byte at @a ptr is in memory owned by this arena.
+   *
+   * @param ptr Address of byte to check.
+   * @return @c true if the byte at @a ptr is in the arena, @c false if not.
+   */
+  bool contains(const void *ptr) const;
+
+  /// @return The number of threads that have allocated from the arena.
+  size_t slot_count() const;
+
+protected:
+  /// Per thread arena.
+  struct alignas(64) Slot {
+    /// Constructor.
+    Slot(MemArena::BlockProvider& provider, size_t n, std::thread::id owner);
+
+    MemArena _arena;        ///< Memory for this thread.
+    std::thread::id _owner; ///< Owning thread.
+  };
+
+  /// Thread local cache entry.
+  struct LocalEntry {
+    uint64_t _id = 0;       ///< Arena identifier.
+    Slot *_slot  = nullptr; ///< Slot for the thread in that arena.
+  };
+
+  /// Number of entries in the thread local cache.
+  static constexpr size_t LOCAL_CACHE_SIZE = 8;
+
+  /// Find or create the slot for the calling thread, and update the thread local cache.
+  MemArena& attach();
+
+  /// Source of unique arena identifiers. These are never reused, which makes stale cache entries harmless.
+  static inline std::atomic<uint64_t> _next_id{1};
+
+  /// Cache of recently used slots for the calling thread.
+  static thread_local std::array<LocalEntry, LOCAL_CACHE_SIZE> _local_cache;
+
+  MemArena::BlockProvider& _provider; ///< Block provider for all slots.
+  size_t _hint;                       ///< Reservation hint for new slots.
+  uint64_t _id;                       ///< Unique identifier.
+  mutable std::mutex _mutex;          ///< Protects @a _slots.
+  std::vector<std::unique_ptr<Slot>> _slots; ///< Per thread arenas.
+};
+
+// --- Implementation
+
+inline thread_local std::array<ConcurrentMemArena::LocalEntry, ConcurrentMemArena::LOCAL_CACHE_SIZE>
+    ConcurrentMemArena::_local_cache;
+
+inline ConcurrentMemArena::Slot::Slot(MemArena::BlockProvider& provider, size_t n, std::thread::id owner)
+    : _arena(n ? MemArena(provider, n) : MemArena(provider)), _owner(owner) {}
+
+inline ConcurrentMemArena::ConcurrentMemArena(size_t n) : ConcurrentMemArena(MemArena::default_provider(), n) {}
+
+inline ConcurrentMemArena::ConcurrentMemArena(MemArena::BlockProvider& provider, size_t n)
+    : _provider(provider), _hint(n), _id(_next_id++) {}
+
+inline MemArena&
+ConcurrentMemArena::local() {
+  auto& entry = _local_cache[_id % LOCAL_CACHE_SIZE];
+  if (entry._id == _id) {
+    return entry._slot->_arena;
+  }
+  return this->attach();
+}
+
+inline MemSpan<void>
+ConcurrentMemArena::alloc(size_t n, size_t align) {
+  return this->local().alloc(n, align);
+}
+
+template <typename T>
+MemSpan<T>
+ConcurrentMemArena::alloc_span(size_t n) {
+  return this->local().alloc_span<T>(n);
+}
+
+template <typename T, typename... Args>
+T *
+ConcurrentMemArena::make(Args&&... args) {
+  return this->local().make<T>(std::forward<Args>(args)...);
+}
+
+}} // namespace swoc
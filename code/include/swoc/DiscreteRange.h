@@ -10,6 +10,9 @@
 #pragma once
 #include <limits>
 #include <functional>
+#include <vector>
+#include <queue>
+#include <algorithm>
 
 #include "swoc/swoc_version.h"
 #include "swoc/swoc_meta.h"
@@ -577,6 +580,7 @@ operator>=(DiscreteRange<T> const& lhs, DiscreteRange<T> const& rhs) {
  *
  * @tparam METRIC Value type for the space.
  * @tparam PAYLOAD Data stored with values in the space.
+ * @tparam EQUAL Payload equality policy.
  *
  * This is a range based mapping of all values in @c METRIC (the "space") to @c PAYLOAD.
  *
@@ -584,8 +588,13 @@ operator>=(DiscreteRange<T> const& lhs, DiscreteRange<T> const& rhs) {
  *
  * @c METRIC must be
  * - discrete and finite valued type with increment and decrement operations.
+ *
+ * @c EQUAL is a default constructible functor with the signature <tt>bool (PAYLOAD const&,
+ * PAYLOAD const&)</tt>. Adjacent ranges with payloads that are equal under this policy are merged.
+ * This can be used for payloads that do not have @c operator== or for which only some members
+ * are significant.
  */
-template<typename METRIC, typename PAYLOAD> class DiscreteSpace {
+template<typename METRIC, typename PAYLOAD, typename EQUAL = std::equal_to<PAYLOAD>> class DiscreteSpace {
   using self_type = DiscreteSpace;
 
 protected:
@@ -619,6 +628,9 @@ protected:
     /// @return The payload in the node.
     PAYLOAD& payload();
 
+    /// @return The payload in the node.
+    PAYLOAD const& payload() const { return _payload; }
+
     /** Set the @a range of a node.
      *
      * @param range Range to use.
@@ -657,7 +669,7 @@ protected:
      */
     self_type&
     dec_max() {
-      _range.dec_max();
+      _range.clip_max();
       this->ripple_structure_fixup();
       return *this;
     }
@@ -712,6 +724,8 @@ public:
   using iterator = typename decltype(_list)::iterator;
   using const_iterator = typename decltype(_list)::const_iterator;
 
+  class Loader;
+
   DiscreteSpace() = default;
 
   ~DiscreteSpace();
@@ -772,6 +786,24 @@ public:
    */
   iterator find(METRIC const& metric);
 
+  /// Number of searches done in lock step by @c find_batch.
+  static constexpr size_t BATCH_GROUP = 16;
+
+  /** Find the payloads for a batch of metrics.
+   *
+   * @param metrics Values to find.
+   * @param results Iterators for the ranges that contain the corresponding element of @a metrics.
+   *
+   * @a results must be at least as large as @a metrics. The result for a value that is not in the
+   * space is @c end().
+   *
+   * This is equivalent to calling @c find for each element of @a metrics, but is faster for
+   * large trees. Groups of searches are done in lock step, one tree level per round, and the next
+   * node for each search is prefetched so that the cache misses for the searches in a group
+   * overlap instead of occurring one after another.
+   */
+  void find_batch(MemSpan<METRIC const> metrics, MemSpan<iterator> results);
+
   /// @return The number of distinct ranges.
   size_t count() const;
 
@@ -779,6 +811,104 @@ public:
 
   iterator end() { return _list.end(); }
 
+  const_iterator begin() const { return _list.begin(); }
+
+  const_iterator end() const { return _list.end(); }
+
+  /** Merge @a that in to @a this.
+   *
+   * @tparam F Combining functor type (deduced).
+   * @param that Other space.
+   * @param combiner Combining functor.
+   * @return @a this
+   *
+   * Every value in either space is in the result. A value in only one of the spaces keeps its
+   * payload. For a value in both, the payloads are combined with @a combiner which has the
+   * signature <tt>bool (PAYLOAD & lhs, PAYLOAD const& rhs)</tt> and the same semantics as the
+   * blender for @c blend - @a lhs is a copy of the payload in @a this which is updated with the
+   * payload @a rhs from @a that. If @a combiner returns @c false the value is not in the result.
+   *
+   * Both spaces are walked in order and @a this is rebuilt directly from the result, so this is
+   * linear in the number of ranges in both spaces.
+   */
+  template <typename F> self_type& merge(self_type const& that, F&& combiner);
+
+  /** Merge @a that in to @a this.
+   *
+   * @param that Other space.
+   * @return @a this
+   *
+   * For values in both spaces, the payload in @a that is used. This is equivalent to marking
+   * every range in @a that in @a this.
+   */
+  self_type& merge(self_type const& that);
+
+  /** Intersect @a this with @a that.
+   *
+   * @tparam F Combining functor type (deduced).
+   * @param that Other space.
+   * @param combiner Combining functor.
+   * @return @a this
+   *
+   * Only values in both spaces are kept. The payloads are combined as for @c merge.
+   */
+  template <typename F> self_type& intersect(self_type const& that, F&& combiner);
+
+  /** Intersect @a this with @a that.
+   *
+   * @param that Other space.
+   * @return @a this
+   *
+   * Only values in both spaces are kept, with the payloads in @a this.
+   */
+  self_type& intersect(self_type const& that);
+
+  /** Subtract @a that from @a this.
+   *
+   * @param that Other space.
+   * @return @a this
+   *
+   * Values in @a that are removed from @a this. This is equivalent to erasing every range in
+   * @a that from @a this.
+   */
+  self_type& subtract(self_type const& that);
+
+  /** Merge adjacent ranges with equal payloads.
+   *
+   * @return @a this
+   *
+   * Equality is determined by the @c EQUAL policy. This is a single linear pass over the ranges
+   * after which the tree is rebuilt once, if any ranges were merged. It is useful after a series
+   * of operations, such as @c blend, that may leave adjacent ranges with equal payloads.
+   */
+  self_type& compact();
+
+  /** Compare payloads using the equality policy.
+   *
+   * @param lhs Payload.
+   * @param rhs Payload.
+   * @return @c true if @a lhs and @a rhs are equal, @c false if not.
+   */
+  static bool equal(PAYLOAD const& lhs, PAYLOAD const& rhs) { return EQUAL{}(lhs, rhs); }
+
+  /** Compute the differences between two spaces.
+   *
+   * @tparam F Delta functor type (deduced).
+   * @param prev Previous space.
+   * @param next Updated space.
+   * @param f Delta functor.
+   *
+   * @a f is called with the signature <tt>void (range_type const& range, PAYLOAD const* prev_payload,
+   * PAYLOAD const* next_payload)</tt> for every range where @a prev and @a next differ, in ascending
+   * order. The payload pointer is @c nullptr if the range is not in that space. Therefore a range
+   * that was added has a @c nullptr @a prev_payload, a range that was removed has a @c nullptr
+   * @a next_payload, and a range with a different payload has neither @c nullptr. Ranges that are
+   * unchanged are not reported.
+   *
+   * Both spaces are walked in order, so this is linear in the number of ranges in both spaces.
+   */
+  template <typename F> static void diff(self_type const& prev, self_type const& next, F&& f);
+
   /// Remove all ranges.
   void clear() {
     for (auto& node : _list) {
@@ -826,32 +956,159 @@ protected:
     _list.erase(node);
     _fa.destroy(node);
   }
+
+  /** Replace the contents of the space.
+   *
+   * @tparam ITER Iterator type, the value must have members @a _range and @a _payload.
+   * @param spot First range.
+   * @param n Number of ranges.
+   *
+   * The ranges must be sorted, disjoint, and coalesced. The nodes are put in a perfectly balanced
+   * tree directly, without rebalancing, in linear time.
+   */
+  template <typename ITER> void build(ITER spot, size_t n);
+
+  /** Walk @a this and @a that in order.
+   *
+   * @param that Other space.
+   * @param only_this Functor invoked for ranges only in @a this.
+   * @param only_that Functor invoked for ranges only in @a that.
+   * @param both Functor invoked for ranges in both spaces.
+   *
+   * The one space functors have the signature <tt>void (METRIC const& min, METRIC const& max,
+   * PAYLOAD const& payload)</tt> and @a both has the signature <tt>void (METRIC const& min,
+   * METRIC const& max, PAYLOAD const& lhs, PAYLOAD const& rhs)</tt>. The functors are called
+   * with disjoint ranges in ascending order.
+   */
+  template <typename FA, typename FB, typename FAB>
+  void sweep(self_type const& that, FA&& only_this, FB&& only_that, FAB&& both) const;
+
+  /** Link @a n nodes starting at @a nodes in to a balanced subtree.
+   *
+   * @param nodes Array of nodes, in order.
+   * @param n Number of nodes.
+   * @param depth Depth of the subtree root.
+   * @param red_depth Depth at which nodes are colored red.
+   * @return The root of the subtree.
+   */
+  static Node *build_tree(Node **nodes, size_t n, unsigned depth, unsigned red_depth);
+
+  /// Rebuild the tree as perfectly balanced from the nodes in the list.
+  void relink();
+};
+
+/** Bulk loader for a @c DiscreteSpace.
+ *
+ * Ranges are accumulated in the loader and then put in the space with a single call to @c load.
+ * The ranges can be in any order. Overlaps are resolved with the same semantics as
+ * @c DiscreteSpace::mark, as if the ranges had been marked in the order they were added to the
+ * loader. Any ranges already in the space are treated as if they were marked before all of the
+ * ranges in the loader. Adjacent ranges with equal payloads are coalesced.
+ *
+ * This is much faster than repeated calls to @c mark for a large number of ranges, as the tree
+ * is built once, without rebalancing. If the ranges are added in sorted order and do not overlap,
+ * loading is linear, otherwise it is dominated by sorting.
+ *
+ * @code
+ * DiscreteSpace<unsigned, int>::Loader loader{space};
+ * for ( auto const& [ range, payload ] : source ) {
+ *   loader.mark(range, payload);
+ * }
+ * loader.load();
+ * @endcode
+ */
+template <typename METRIC, typename PAYLOAD, typename EQUAL> class DiscreteSpace<METRIC, PAYLOAD, EQUAL>::Loader {
+  using self_type = Loader; ///< Self reference type.
+  friend DiscreteSpace;
+
+public:
+  /** Construct a loader for @a space.
+   *
+   * @param space Target space.
+   */
+  explicit Loader(DiscreteSpace& space) : _space(space) {}
+
+  /** Add a range to load.
+   *
+   * @param range Range to mark.
+   * @param payload Payload for @a range.
+   * @return @a this
+   */
+  self_type& mark(range_type const& range, PAYLOAD const& payload);
+
+  /** Reserve space for @a n ranges.
+   *
+   * @param n Number of ranges expected.
+   * @return @a this
+   */
+  self_type&
+  reserve(size_t n) {
+    _items.reserve(n);
+    return *this;
+  }
+
+  /// @return The number of ranges added.
+  size_t
+  count() const {
+    return _items.size();
+  }
+
+  /** Load the ranges in to the space.
+   *
+   * @return The space.
+   *
+   * The loader is cleared and can be reused.
+   */
+  DiscreteSpace& load();
+
+protected:
+  /// Range to load.
+  struct Item {
+    range_type _range; ///< Range.
+    PAYLOAD _payload;  ///< Payload.
+    size_t _seq;       ///< Order of addition, later has priority.
+  };
+
+  DiscreteSpace& _space;     ///< Target space.
+  std::vector<Item> _items;  ///< Accumulated ranges.
+  bool _ordered_p = true; ///< Ranges were added sorted and disjoint.
+
+  /** Append a range to sorted, disjoint @a items.
+   *
+   * @param items Ranges.
+   * @param min Minimum of the range, must be after every range in @a items.
+   * @param max Maximum of the range.
+   * @param payload Payload for the range.
+   *
+   * The range is coalesced with the last range in @a items if possible.
+   */
+  static void append(std::vector<Item>& items, METRIC const& min, METRIC const& max, PAYLOAD const& payload);
 };
 
 // ---
 
-template<typename METRIC, typename PAYLOAD>
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
 PAYLOAD&
-DiscreteSpace<METRIC, PAYLOAD>::Node::payload() {
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::Node::payload() {
   return _payload;
 }
 
-template<typename METRIC, typename PAYLOAD>
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
 auto
-DiscreteSpace<METRIC, PAYLOAD>::Node::assign(DiscreteSpace::range_type const& range) -> self_type& {
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::Node::assign(DiscreteSpace::range_type const& range) -> self_type& {
   _range = range;
   return *this;
 }
 
-template<typename METRIC, typename PAYLOAD>
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
 auto
-DiscreteSpace<METRIC, PAYLOAD>::Node::assign(PAYLOAD const& payload) -> self_type& {
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::Node::assign(PAYLOAD const& payload) -> self_type& {
   _payload = payload;
   return *this;
 }
 
-template<typename METRIC, typename PAYLOAD>
-void DiscreteSpace<METRIC, PAYLOAD>::Node::structure_fixup() {
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+void DiscreteSpace<METRIC, PAYLOAD, EQUAL>::Node::structure_fixup() {
   // Invariant: The hulls of all children are correct.
   if (_left && _right) {
     // If both children, local range must be inside the hull of the children and irrelevant.
@@ -867,26 +1124,26 @@ void DiscreteSpace<METRIC, PAYLOAD>::Node::structure_fixup() {
 
 // ---
 
-template<typename METRIC, typename PAYLOAD>
-DiscreteSpace<METRIC, PAYLOAD>::~DiscreteSpace() {
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::~DiscreteSpace() {
   // Destruct all the payloads - the nodes themselves are in the arena and disappear with it.
   for (auto& node : _list) {
     std::destroy_at(&node.payload());
   }
 }
 
-template<typename METRIC, typename PAYLOAD>
-size_t DiscreteSpace<METRIC, PAYLOAD>::count() const { return _list.count(); }
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+size_t DiscreteSpace<METRIC, PAYLOAD, EQUAL>::count() const { return _list.count(); }
 
-template<typename METRIC, typename PAYLOAD>
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
 auto
-DiscreteSpace<METRIC, PAYLOAD>::head() -> Node * {
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::head() -> Node * {
   return static_cast<Node *>(_list.head());
 }
 
-template<typename METRIC, typename PAYLOAD>
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
 auto
-DiscreteSpace<METRIC, PAYLOAD>::find(METRIC const& metric) -> iterator {
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::find(METRIC const& metric) -> iterator {
   auto n = _root; // current node to test.
   while (n) {
     if (metric < n->min()) {
@@ -908,8 +1165,48 @@ DiscreteSpace<METRIC, PAYLOAD>::find(METRIC const& metric) -> iterator {
   return this->end();
 }
 
-template<typename METRIC, typename PAYLOAD>
-auto DiscreteSpace<METRIC, PAYLOAD>::lower_bound(METRIC const& target) -> Node * {
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+void
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::find_batch(MemSpan<METRIC const> metrics, MemSpan<iterator> results) {
+  Node *lanes[BATCH_GROUP]; // current node for each search in the group.
+  for (size_t base = 0; base < metrics.count(); base += BATCH_GROUP) {
+    auto n      = std::min(BATCH_GROUP, metrics.count() - base);
+    auto keys   = metrics.data() + base;
+    auto found  = results.data() + base;
+    bool active = _root != nullptr;
+    for (size_t idx = 0; idx < n; ++idx) {
+      lanes[idx] = _root;
+      found[idx] = this->end();
+    }
+    while (active) {
+      active = false;
+      for (size_t idx = 0; idx < n; ++idx) {
+        Node *node = lanes[idx];
+        if (nullptr == node) {
+          continue;
+        }
+        auto const& key = keys[idx];
+        if (key < node->min()) {
+          node = node->_hull.contains(key) ? node->left() : nullptr;
+        } else if (node->max() < key) {
+          node = node->_hull.contains(key) ? node->right() : nullptr;
+        } else {
+          found[idx] = _list.iterator_for(node);
+          node       = nullptr;
+        }
+        if (node) {
+          __builtin_prefetch(node);
+          __builtin_prefetch(&node->_hull);
+          active = true;
+        }
+        lanes[idx] = node;
+      }
+    }
+  }
+}
+
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+auto DiscreteSpace<METRIC, PAYLOAD, EQUAL>::lower_bound(METRIC const& target) -> Node * {
   Node *n = _root;   // current node to test.
   Node *zret = nullptr; // best node so far.
 
@@ -933,8 +1230,8 @@ auto DiscreteSpace<METRIC, PAYLOAD>::lower_bound(METRIC const& target) -> Node *
   return zret;
 }
 
-template<typename METRIC, typename PAYLOAD>
-void DiscreteSpace<METRIC, PAYLOAD>::prepend(DiscreteSpace::Node *node) {
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+void DiscreteSpace<METRIC, PAYLOAD, EQUAL>::prepend(DiscreteSpace::Node *node) {
   if (!_root) {
     _root = node;
   } else {
@@ -943,8 +1240,8 @@ void DiscreteSpace<METRIC, PAYLOAD>::prepend(DiscreteSpace::Node *node) {
   _list.prepend(node);
 }
 
-template<typename METRIC, typename PAYLOAD>
-void DiscreteSpace<METRIC, PAYLOAD>::append(DiscreteSpace::Node *node) {
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+void DiscreteSpace<METRIC, PAYLOAD, EQUAL>::append(DiscreteSpace::Node *node) {
   if (!_root) {
     _root = node;
   } else {
@@ -954,9 +1251,9 @@ void DiscreteSpace<METRIC, PAYLOAD>::append(DiscreteSpace::Node *node) {
   _list.append(node);
 }
 
-template<typename METRIC, typename PAYLOAD>
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
 void
-DiscreteSpace<METRIC, PAYLOAD>::insert_before(DiscreteSpace::Node *spot
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::insert_before(DiscreteSpace::Node *spot
                                               , DiscreteSpace::Node *node) {
   if (left(spot) == nullptr) {
     spot->set_child(node, Direction::LEFT);
@@ -971,9 +1268,9 @@ DiscreteSpace<METRIC, PAYLOAD>::insert_before(DiscreteSpace::Node *spot
   _root = static_cast<Node *>(node->rebalance_after_insert());
 }
 
-template<typename METRIC, typename PAYLOAD>
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
 void
-DiscreteSpace<METRIC, PAYLOAD>::insert_after(DiscreteSpace::Node *spot, DiscreteSpace::Node *node) {
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::insert_after(DiscreteSpace::Node *spot, DiscreteSpace::Node *node) {
   if (right(spot) == nullptr) {
     spot->set_child(node, Direction::RIGHT);
   } else {
@@ -987,10 +1284,13 @@ DiscreteSpace<METRIC, PAYLOAD>::insert_after(DiscreteSpace::Node *spot, Discrete
   _root = static_cast<Node *>(node->rebalance_after_insert());
 }
 
-template<typename METRIC, typename PAYLOAD>
-DiscreteSpace<METRIC, PAYLOAD>&
-DiscreteSpace<METRIC, PAYLOAD>::erase(DiscreteSpace::range_type const& range) {
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>&
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::erase(DiscreteSpace::range_type const& range) {
   Node *n = this->lower_bound(range.min()); // current node.
+  if (nullptr == n) { // all ranges start after @a range.min(), but may still overlap.
+    n = this->head();
+  }
   while (n) {
     auto nn = next(n); // cache in case @a n disappears.
     if (n->min() > range.max()) { // cleared the target range, done.
@@ -1018,9 +1318,9 @@ DiscreteSpace<METRIC, PAYLOAD>::erase(DiscreteSpace::range_type const& range) {
   return *this;
 }
 
-template<typename METRIC, typename PAYLOAD>
-DiscreteSpace<METRIC, PAYLOAD>&
-DiscreteSpace<METRIC, PAYLOAD>::mark(DiscreteSpace::range_type const& range
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>&
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::mark(DiscreteSpace::range_type const& range
                                      , PAYLOAD const& payload) {
   Node *n = this->lower_bound(range.min()); // current node.
   Node *x = nullptr;                       // New node, gets set if we re-use an existing one.
@@ -1040,7 +1340,7 @@ DiscreteSpace<METRIC, PAYLOAD>::mark(DiscreteSpace::range_type const& range
       // Coalesce if the data is the same. min_minus_1 is OK because
       // if there is a previous range, min is not zero.
       Node *p = prev(n);
-      if (p && p->payload() == payload && p->max() == min_minus_1) {
+      if (p && equal(p->payload(), payload) && p->max() == min_minus_1) {
         x = p;
         n = x; // need to back up n because frame of reference moved.
         x->assign_max(range.max());
@@ -1048,7 +1348,7 @@ DiscreteSpace<METRIC, PAYLOAD>::mark(DiscreteSpace::range_type const& range
         // Span will be subsumed by request span so it's available for use.
         x = n;
         x->assign_max(range.max()).assign(payload);
-      } else if (n->payload() == payload) {
+      } else if (equal(n->payload(), payload)) {
         return *this; // request is covered by existing span with the same data
       } else {
         // request span is covered by existing span.
@@ -1057,7 +1357,7 @@ DiscreteSpace<METRIC, PAYLOAD>::mark(DiscreteSpace::range_type const& range
         this->insert_before(n, x);
         return *this;
       }
-    } else if (n->payload() == payload && n->max() >= min_minus_1) {
+    } else if (equal(n->payload(), payload) && n->max() >= min_minus_1) {
       // min_minus_1 is safe here because n->_min < min so min is not zero.
       x = n;
       // If the existing span covers the requested span, we're done.
@@ -1100,7 +1400,7 @@ DiscreteSpace<METRIC, PAYLOAD>::mark(DiscreteSpace::range_type const& range
       }
     }
   } else if (nullptr != (n = this->head()) &&                  // at least one node in tree.
-             n->payload() == payload &&                            // payload matches
+             equal(n->payload(), payload) &&                     // payload matches
              (n->max() <= range.max() || n->min() <= max_plus_1) // overlap or adj.
       ) {
     // Same payload with overlap, re-use.
@@ -1124,7 +1424,7 @@ DiscreteSpace<METRIC, PAYLOAD>::mark(DiscreteSpace::range_type const& range
       this->remove(y);
     } else if (max_plus_1 < n->min()) { // no overlap, done.
       break;
-    } else if (n->payload() == payload) { // skew overlap or adj., same payload
+    } else if (equal(n->payload(), payload)) { // skew overlap or adj., same payload
       x->assign_max(n->max());
       y = n;
       n = next(n);
@@ -1140,11 +1440,11 @@ DiscreteSpace<METRIC, PAYLOAD>::mark(DiscreteSpace::range_type const& range
   return *this;
 }
 
-template<typename METRIC, typename PAYLOAD>
-DiscreteSpace<METRIC, PAYLOAD>&
-DiscreteSpace<METRIC, PAYLOAD>::fill(DiscreteSpace::range_type const& range
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>&
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::fill(DiscreteSpace::range_type const& range
                                      , PAYLOAD const& payload) {
-  // Rightmost node of interest with n->_min <= min.
+  // Rightmost node of interest with n->min() <= min.
   Node *n = this->lower_bound(range.min());
   Node *x = nullptr; // New node (if any).
   // Need copies because we will modify these.
@@ -1154,14 +1454,14 @@ DiscreteSpace<METRIC, PAYLOAD>::fill(DiscreteSpace::range_type const& range
   // Handle cases involving a node of interest to the left of the
   // range.
   if (n) {
-    if (n->_min < min) {
+    if (n->min() < min) {
       auto min_1 = min;
       --min_1;               // dec is OK because min isn't zero.
       if (n->max() < min_1) { // no overlap, not adjacent.
         n = next(n);
       } else if (n->max() >= max) { // incoming range is covered, just discard.
         return *this;
-      } else if (n->payload != payload) { // different payload, clip range on left.
+      } else if (!equal(n->payload(), payload)) { // different payload, clip range on left.
         min = n->max();
         ++min;
         n = next(n);
@@ -1188,14 +1488,14 @@ DiscreteSpace<METRIC, PAYLOAD>::fill(DiscreteSpace::range_type const& range
      - we must have either x != 0 or adjust min but not both for each loop iteration.
   */
   while (n) {
-    if (n->data() == payload) {
+    if (equal(n->payload(), payload)) {
       if (x) {
-        if (n->_max <= max) { // next range is covered, so we can remove and continue.
+        if (n->max() <= max) { // next range is covered, so we can remove and continue.
           this->remove(n);
           n = next(x);
-        } else if (n->_min <= max_plus1) {
+        } else if (n->min() <= max_plus1) {
           // Overlap or adjacent with larger max - absorb and finish.
-          x->assign_max(n->_max);
+          x->assign_max(n->max());
           this->remove(n);
           return *this;
         } else {
@@ -1204,11 +1504,11 @@ DiscreteSpace<METRIC, PAYLOAD>::fill(DiscreteSpace::range_type const& range
           return *this;
         }
       } else {                // not carrying a span.
-        if (n->_max <= max) { // next range is covered - use it.
+        if (n->max() <= max) { // next range is covered - use it.
           x = n;
           x->assign_min(min);
           n = next(n);
-        } else if (n->_min <= max_plus1) {
+        } else if (n->min() <= max_plus1) {
           n->assign_min(min);
           return *this;
         } else { // no overlap, space to complete range.
@@ -1218,33 +1518,33 @@ DiscreteSpace<METRIC, PAYLOAD>::fill(DiscreteSpace::range_type const& range
       }
     } else { // different payload
       if (x) {
-        if (max < n->_min) { // range ends before n starts, done.
+        if (max < n->min()) { // range ends before n starts, done.
           x->assign_max(max);
           return *this;
-        } else if (max <= n->_max) { // range ends before n, done.
-          x->assign_max(n->_min).dec_max();
+        } else if (max <= n->max()) { // range ends before n, done.
+          x->assign_max(n->min()).dec_max();
           return *this;
         } else { // n is contained in range, skip over it.
-          x->assign_max(n->_min).dec_max();
+          x->assign_max(n->min()).dec_max();
           x = nullptr;
-          min = n->_max;
-          ++min; // OK because n->_max maximal => next is null.
+          min = n->max();
+          ++min; // OK because n->max() maximal => next is null.
           n = next(n);
         }
       } else {               // no carry node.
-        if (max < n->_min) { // entirely before next span.
+        if (max < n->min()) { // entirely before next span.
           this->insert_before(n, _fa.make(min, max, payload));
           return *this;
         } else {
-          if (min < n->_min) { // leading section, need node.
-            auto y = _fa.make(min, n->_min, payload);
+          if (min < n->min()) { // leading section, need node.
+            auto y = _fa.make(min, n->min(), payload);
             y->dec_max();
             this->insert_before(n, y);
           }
-          if (max <= n->_max) { // nothing past node
+          if (max <= n->max()) { // nothing past node
             return *this;
           }
-          min = n->_max;
+          min = n->max();
           ++min;
           n = next(n);
         }
@@ -1260,10 +1560,10 @@ DiscreteSpace<METRIC, PAYLOAD>::fill(DiscreteSpace::range_type const& range
   return *this;
 }
 
-template<typename METRIC, typename PAYLOAD>
+template<typename METRIC, typename PAYLOAD, typename EQUAL>
 template<typename F, typename U>
 auto
-DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U const& color
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::blend(DiscreteSpace::range_type const& range, U const& color
                                       , F&& blender) -> self_type& {
   // Do a base check for the color to use on unmapped values. If self blending on @a color
   // is @c false, then do not color currently unmapped values.
@@ -1307,7 +1607,7 @@ DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U
       bool fill_p = blender(fill->payload(), color); // fill or clear?
 
       if (fill_p) {
-        bool same_color_p = fill->payload() == n->payload();
+        bool same_color_p = equal(fill->payload(), n->payload());
         if (same_color_p && n->max() >= remaining.max()) {
           return *this; // incoming range is completely covered by @a n in the same color, done.
         }
@@ -1355,7 +1655,7 @@ DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U
     // @a n is adjacent on the right to @a remaining.
     bool right_adj_p = !right_overlap_p && remaining.is_left_adjacent_to(n->range());
     // @a n has the same color as would be used for unmapped values.
-    bool n_plain_colored_p = plain_color_p && (n->payload() == plain_color);
+    bool n_plain_colored_p = plain_color_p && equal(n->payload(), plain_color);
 
     // Check for no right overlap - that means @a n is past the target range.
     // It may be possible to extend @a n or the previous range to cover
@@ -1365,7 +1665,7 @@ DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U
       // and is adjacent to @a remaining.
       bool pred_plain_colored_p = pred &&
           ++metric_type(pred->max()) == remaining.min() &&
-          pred->payload() == plain_color;
+          equal(pred->payload(), plain_color);
 
       if (right_adj_p && n_plain_colored_p) { // can pull @a n left to cover
         n->assign_min(remaining.min());
@@ -1386,8 +1686,8 @@ DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U
 
     // If there's a gap on the left, fill from @a r.min to @a n.min - 1
     if (plain_color_p && remaining.min() < n->min()) {
-      if (n->payload() == plain_color) {
-        if (pred && pred->payload() == n->payload()) {
+      if (equal(n->payload(), plain_color)) {
+        if (pred && equal(pred->payload(), n->payload())) {
           auto pred_min{pred->min()};
           this->remove(pred);
           n->assign_min(pred_min);
@@ -1397,7 +1697,7 @@ DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U
       } else {
         auto n_min_minus_1{n->min()};
         --n_min_minus_1;
-        if (pred && pred->payload() == plain_color) {
+        if (pred && equal(pred->payload(), plain_color)) {
           pred->assign_max(n_min_minus_1);
         } else {
           this->insert_before(n, _fa.make(remaining.min(), n_min_minus_1, plain_color));
@@ -1419,10 +1719,10 @@ DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U
       // Check if @a pred is suitable for extending right to cover the target range.
       bool pred_adj_p = nullptr != (pred = prev(n)) &&
           pred->range().is_left_adjacent_to(fill->range()) &&
-          pred->payload() == fill->payload();
+          equal(pred->payload(), fill->payload());
 
       if (right_ext_p) {
-        if (n->payload() == fill->payload()) {
+        if (equal(n->payload(), fill->payload())) {
           n->assign_min(fill->min());
         } else {
           n->assign_min(range_max_plus_1);
@@ -1460,7 +1760,7 @@ DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U
     // Check if the last node can be extended to cover because it's left adjacent.
     // Can decrement @a range_min because if there's a range to the left, @a range_min is not minimal.
     n = _list.tail();
-    if (n && n->max() >= --metric_type{remaining.min()} && n->payload() == plain_color) {
+    if (n && n->max() >= --metric_type{remaining.min()} && equal(n->payload(), plain_color)) {
       n->assign_max(range.max());
     } else {
       this->append(_fa.make(remaining.min(), remaining.max(), plain_color));
@@ -1470,4 +1770,327 @@ DiscreteSpace<METRIC, PAYLOAD>::blend(DiscreteSpace::range_type const& range, U
   return *this;
 }
 
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::build_tree(Node **nodes, size_t n, unsigned depth, unsigned red_depth) -> Node * {
+  if (n == 0) {
+    return nullptr;
+  }
+  auto mid = n / 2;
+  Node *node = nodes[mid];
+  node->_parent = nullptr;
+  node->_left = build_tree(nodes, mid, depth + 1, red_depth);
+  node->_right = build_tree(nodes + mid + 1, n - mid - 1, depth + 1, red_depth);
+  if (node->_left) {
+    node->_left->_parent = node;
+  }
+  if (node->_right) {
+    node->_right->_parent = node;
+  }
+  // Splitting at the middle puts every leaf at the bottom level or the one above it. Coloring
+  // only the bottom level red makes every path have the same number of black nodes.
+  node->_color = (depth == red_depth && depth > 0) ? Node::Color::RED : Node::Color::BLACK;
+  node->structure_fixup();
+  return node;
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+template <typename ITER>
+void
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::build(ITER spot, size_t n) {
+  this->clear();
+  if (n == 0) {
+    return;
+  }
+  _arena.require(n * sizeof(Node));
+  while (n--) {
+    _list.append(_fa.make(spot->_range, spot->_payload));
+    ++spot;
+  }
+  this->relink();
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+void
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::relink() {
+  std::vector<Node *> nodes;
+  nodes.reserve(_list.count());
+  for (auto& node : _list) {
+    nodes.push_back(&node);
+  }
+  unsigned red_depth = 0; // depth of the bottom level of the tree.
+  for (auto k = nodes.size(); k > 1; k >>= 1) {
+    ++red_depth;
+  }
+  _root = build_tree(nodes.data(), nodes.size(), 0, red_depth);
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::compact() -> self_type& {
+  bool changed_p = false;
+  for (Node *n = this->head(); n;) {
+    Node *nn = next(n);
+    while (nn && equal(n->payload(), nn->payload()) && n->range().is_left_adjacent_to(nn->range())) {
+      // The tree is rebuilt afterwards, so only the list needs to be updated.
+      n->_range.assign_max(nn->max());
+      _list.erase(nn);
+      _fa.destroy(nn);
+      nn        = next(n);
+      changed_p = true;
+    }
+    n = nn;
+  }
+  if (changed_p) {
+    this->relink();
+  }
+  return *this;
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::Loader::mark(range_type const& range, PAYLOAD const& payload) -> self_type& {
+  if (!range.empty()) {
+    if (_ordered_p && !_items.empty() && !(_items.back()._range.max() < range.min())) {
+      _ordered_p = false;
+    }
+    _items.push_back(Item{range, payload, _items.size()});
+  }
+  return *this;
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+void
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::Loader::append(std::vector<Item>& items, METRIC const& min, METRIC const& max, PAYLOAD const& payload) {
+  if (!items.empty() && DiscreteSpace::equal(items.back()._payload, payload) && items.back()._range.is_left_adjacent_to(range_type{min, max})) {
+    items.back()._range.assign_max(max);
+  } else {
+    items.push_back(Item{range_type{min, max}, payload, 0});
+  }
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::Loader::load() -> DiscreteSpace& {
+  std::vector<Item> items;
+  // Pull in the current contents of the space as the lowest priority ranges.
+  if (_space.count()) {
+    items.reserve(_space.count() + _items.size());
+    for (auto& node : _space) {
+      items.push_back(Item{node.range(), node.payload(), items.size()});
+    }
+    if (!_items.empty() && !(items.back()._range.max() < _items.front()._range.min())) {
+      _ordered_p = false;
+    }
+    for (auto& item : _items) {
+      item._seq = items.size();
+      items.push_back(std::move(item));
+    }
+  } else {
+    items = std::move(_items);
+  }
+  _items.clear();
+
+  std::vector<Item> result; // Sorted, disjoint, coalesced ranges.
+  result.reserve(items.size());
+  // Add a range to the result, coalescing if possible.
+
+  if (_ordered_p) {
+    for (auto& item : items) {
+      append(result, item._range.min(), item._range.max(), item._payload);
+    }
+  } else {
+    std::sort(items.begin(), items.end(), [](Item const& lhs, Item const& rhs) {
+      return lhs._range.min() < rhs._range.min() || (lhs._range.min() == rhs._range.min() && lhs._seq < rhs._seq);
+    });
+    // Sweep across the ranges, tracking the ranges that cover the current position. The one
+    // that was marked last is on top of the heap and supplies the payload.
+    auto later = [&](size_t lhs, size_t rhs) { return items[lhs]._seq < items[rhs]._seq; };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> active(later);
+    size_t idx = 0;
+    METRIC pos;
+    while (idx < items.size() || !active.empty()) {
+      if (active.empty()) {
+        pos = items[idx]._range.min();
+      }
+      while (idx < items.size() && items[idx]._range.min() == pos) {
+        active.push(idx++);
+      }
+      auto& top = items[active.top()];
+      // Current segment ends at the end of @a top or just before the next range starts.
+      METRIC max = top._range.max();
+      if (idx < items.size() && items[idx]._range.min() <= max) {
+        max = items[idx]._range.min();
+        --max; // OK because the next range starts after @a pos.
+      }
+      append(result, pos, max, top._payload);
+      if (max == detail::maximum<METRIC>()) {
+        break; // nothing can be past this.
+      }
+      pos = max;
+      ++pos;
+      // Drop ranges that have been passed. Those not on top are dropped when they get there.
+      while (!active.empty() && items[active.top()]._range.max() < pos) {
+        active.pop();
+      }
+    }
+  }
+  _ordered_p = true;
+
+  _space.build(result.begin(), result.size());
+  return _space;
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+template <typename FA, typename FB, typename FAB>
+void
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::sweep(self_type const& that, FA&& only_this, FB&& only_that, FAB&& both) const {
+  auto a       = _list.begin();
+  auto a_limit = _list.end();
+  auto b       = that._list.begin();
+  auto b_limit = that._list.end();
+  METRIC a_min; // Start of the part of @a a not yet processed.
+  METRIC b_min; // Start of the part of @a b not yet processed.
+  if (a != a_limit) {
+    a_min = a->min();
+  }
+  if (b != b_limit) {
+    b_min = b->min();
+  }
+  // Increments below are safe because the other range has a larger maximum.
+  while (a != a_limit && b != b_limit) {
+    if (a_min < b_min) {
+      if (a->max() < b_min) {
+        only_this(a_min, a->max(), a->payload());
+        if (++a != a_limit) {
+          a_min = a->min();
+        }
+      } else {
+        only_this(a_min, --METRIC{b_min}, a->payload());
+        a_min = b_min;
+      }
+    } else if (b_min < a_min) {
+      if (b->max() < a_min) {
+        only_that(b_min, b->max(), b->payload());
+        if (++b != b_limit) {
+          b_min = b->min();
+        }
+      } else {
+        only_that(b_min, --METRIC{a_min}, b->payload());
+        b_min = a_min;
+      }
+    } else if (a->max() < b->max()) {
+      both(a_min, a->max(), a->payload(), b->payload());
+      b_min = ++METRIC{a->max()};
+      if (++a != a_limit) {
+        a_min = a->min();
+      }
+    } else if (b->max() < a->max()) {
+      both(b_min, b->max(), a->payload(), b->payload());
+      a_min = ++METRIC{b->max()};
+      if (++b != b_limit) {
+        b_min = b->min();
+      }
+    } else {
+      both(a_min, a->max(), a->payload(), b->payload());
+      if (++a != a_limit) {
+        a_min = a->min();
+      }
+      if (++b != b_limit) {
+        b_min = b->min();
+      }
+    }
+  }
+  while (a != a_limit) {
+    only_this(a_min, a->max(), a->payload());
+    if (++a != a_limit) {
+      a_min = a->min();
+    }
+  }
+  while (b != b_limit) {
+    only_that(b_min, b->max(), b->payload());
+    if (++b != b_limit) {
+      b_min = b->min();
+    }
+  }
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+template <typename F>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::merge(self_type const& that, F&& combiner) -> self_type& {
+  std::vector<typename Loader::Item> result;
+  result.reserve(this->count() + that.count());
+  auto keep = [&](METRIC const& min, METRIC const& max, PAYLOAD const& payload) -> void {
+    Loader::append(result, min, max, payload);
+  };
+  this->sweep(that, keep, keep, [&](METRIC const& min, METRIC const& max, PAYLOAD const& lhs, PAYLOAD const& rhs) -> void {
+    PAYLOAD payload{lhs};
+    if (combiner(payload, rhs)) {
+      Loader::append(result, min, max, payload);
+    }
+  });
+  this->build(result.begin(), result.size());
+  return *this;
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::merge(self_type const& that) -> self_type& {
+  return this->merge(that, [](PAYLOAD& lhs, PAYLOAD const& rhs) -> bool {
+    lhs = rhs;
+    return true;
+  });
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+template <typename F>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::intersect(self_type const& that, F&& combiner) -> self_type& {
+  std::vector<typename Loader::Item> result;
+  result.reserve(std::max(this->count(), that.count()));
+  auto drop = [](METRIC const&, METRIC const&, PAYLOAD const&) -> void {};
+  this->sweep(that, drop, drop, [&](METRIC const& min, METRIC const& max, PAYLOAD const& lhs, PAYLOAD const& rhs) -> void {
+    PAYLOAD payload{lhs};
+    if (combiner(payload, rhs)) {
+      Loader::append(result, min, max, payload);
+    }
+  });
+  this->build(result.begin(), result.size());
+  return *this;
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::intersect(self_type const& that) -> self_type& {
+  return this->intersect(that, [](PAYLOAD&, PAYLOAD const&) -> bool { return true; });
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+template <typename F>
+void
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::diff(self_type const& prev, self_type const& next, F&& f) {
+  prev.sweep(
+    next, [&](METRIC const& min, METRIC const& max, PAYLOAD const& payload) -> void { f(range_type{min, max}, &payload, nullptr); },
+    [&](METRIC const& min, METRIC const& max, PAYLOAD const& payload) -> void { f(range_type{min, max}, nullptr, &payload); },
+    [&](METRIC const& min, METRIC const& max, PAYLOAD const& lhs, PAYLOAD const& rhs) -> void {
+      if (!equal(lhs, rhs)) {
+        f(range_type{min, max}, &lhs, &rhs);
+      }
+    });
+}
+
+template <typename METRIC, typename PAYLOAD, typename EQUAL>
+auto
+DiscreteSpace<METRIC, PAYLOAD, EQUAL>::subtract(self_type const& that) -> self_type& {
+  std::vector<typename Loader::Item> result;
+  result.reserve(this->count());
+  auto drop = [](METRIC const&, METRIC const&, PAYLOAD const&) -> void {};
+  this->sweep(
+    that, [&](METRIC const& min, METRIC const& max, PAYLOAD const& payload) -> void { Loader::append(result, min, max, payload); },
+    drop, [](METRIC const&, METRIC const&, PAYLOAD const&, PAYLOAD const&) -> void {});
+  this->build(result.begin(), result.size());
+  return *this;
+}
+
 }} // namespace swoc
@@ -0,0 +1,689 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+  Open addressing hash map.
+
+  A hash map that stores elements directly in an array, probed by groups of control bytes. It uses
+  the same descriptor as @c IntrusiveHashMap for the key and hash.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <iterator>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "swoc/swoc_version.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+namespace detail {
+/** A group of control bytes for @c FlatHashMap.
+
+    Each control byte is the state of the corresponding slot. If the slot has an element, the byte is
+    the low 7 bits of the hash of the element key. Otherwise the high bit is set and the byte is
+    @c EMPTY or @c DELETED.
+
+    Matches are returned as bit masks, bit @a i set for control byte @a i.
+ */
+struct FlatHashGroup {
+  static constexpr size_t SIZE    = 16;   ///< Number of control bytes in a group.
+  static constexpr int8_t EMPTY   = -128; ///< Slot has never been used.
+  static constexpr int8_t DELETED = -2;   ///< Slot was used but the element was erased.
+
+  /// Load the group at @a ctrl.
+  explicit FlatHashGroup(int8_t const *ctrl);
+
+  /// Mask of slots with elements that have hash bits @a h2.
+  uint32_t match(int8_t h2) const;
+
+  /// Mask of slots that are @c EMPTY.
+  uint32_t match_empty() const;
+
+  /// Mask of slots without elements, either @c EMPTY or @c DELETED.
+  uint32_t match_free() const;
+
+#if defined(__SSE2__)
+  __m128i _ctrl; ///< Control bytes.
+#else
+  uint64_t _ctrl[2]; ///< Control bytes.
+#endif
+};
+
+#if defined(__SSE2__)
+inline FlatHashGroup::FlatHashGroup(int8_t const *ctrl) : _ctrl(_mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl))) {}
+
+inline uint32_t
+FlatHashGroup::match(int8_t h2) const {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl));
+}
+
+inline uint32_t
+FlatHashGroup::match_empty() const {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(EMPTY), _ctrl));
+}
+
+inline uint32_t
+FlatHashGroup::match_free() const {
+  return _mm_movemask_epi8(_ctrl); // free slots are exactly those with the high bit set.
+}
+#else
+// Portable version, which checks 8 control bytes at a time in a 64 bit word.
+inline constexpr uint64_t FHG_LSB = 0x0101010101010101ULL; ///< Low bit of each byte.
+inline constexpr uint64_t FHG_MSB = 0x8080808080808080ULL; ///< High bit of each byte.
+
+/// Convert the high bit of each byte in @a w to a bit per byte.
+inline uint32_t
+fhg_bits(uint64_t w) {
+  return ((w >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+/// High bit set for each byte in @a w that is zero.
+inline uint64_t
+fhg_zero(uint64_t w) {
+  // Exact, unlike the shorter form which can flag bytes above a zero byte.
+  return ~(((w & ~FHG_MSB) + ~FHG_MSB) | w | ~FHG_MSB);
+}
+
+inline FlatHashGroup::FlatHashGroup(int8_t const *ctrl) {
+  std::memcpy(_ctrl, ctrl, sizeof(_ctrl));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ // control byte @a i must be byte @a i of the word.
+  _ctrl[0] = __builtin_bswap64(_ctrl[0]);
+  _ctrl[1] = __builtin_bswap64(_ctrl[1]);
+#endif
+}
+
+inline uint32_t
+FlatHashGroup::match(int8_t h2) const {
+  uint64_t x = FHG_LSB * static_cast<uint8_t>(h2);
+  return fhg_bits(fhg_zero(_ctrl[0] ^ x)) | fhg_bits(fhg_zero(_ctrl[1] ^ x)) << 8;
+}
+
+inline uint32_t
+FlatHashGroup::match_empty() const {
+  // EMPTY is the only control byte with the high bit set and bit 1 clear.
+  return fhg_bits(_ctrl[0] & ~(_ctrl[0] << 6) & FHG_MSB) | fhg_bits(_ctrl[1] & ~(_ctrl[1] << 6) & FHG_MSB) << 8;
+}
+
+inline uint32_t
+FlatHashGroup::match_free() const {
+  return fhg_bits(_ctrl[0] & FHG_MSB) | fhg_bits(_ctrl[1] & FHG_MSB) << 8;
+}
+#endif
+} // namespace detail
+
+/** Open addressing hash map.
+
+    The elements are stored in an array of slots, with a parallel array of control bytes that hold a
+    few bits of the hash of each element. A lookup checks a group of control bytes at a time, and
+    compares keys only for slots where those bits match. This avoids the pointer chasing of
+    @c IntrusiveHashMap and is much faster for lookup heavy tables with small keys.
+
+    @tparam H The descriptor, which must provide the static methods @c key_of, @c hash_of and @c equal as
+    for @c IntrusiveHashMap. Other methods are ignored, therefore a descriptor for @c IntrusiveHashMap
+    can be used unchanged.
+    @tparam T The type stored in the map.
+
+    If @a T is a pointer type, the map stores pointers to elements and @c H::key_of is passed the stored
+    pointer. Similar to @c IntrusiveHashMap, the elements are not owned by the map. Otherwise the map
+    stores values of type @a T and @c H::key_of is passed a pointer to the stored value. The values are
+    destroyed with the map.
+
+    Keys are unique. Unlike @c IntrusiveHashMap, inserting an element with the same key as an element
+    already in the map fails. Inserting or erasing elements can move other elements, which invalidates
+    all iterators and references.
+ */
+template<typename H, typename T> class FlatHashMap {
+  using self_type = FlatHashMap; ///< Self reference type.
+  using Group     = detail::FlatHashGroup;
+
+public:
+  /// Type stored in the map.
+  using value_type = T;
+  /// Type passed to @c H::key_of.
+  using element_ptr = std::conditional_t<std::is_pointer_v<T>, T, T *>;
+  /// Key type for the elements.
+  using key_type = decltype(H::key_of(std::declval<element_ptr>()));
+  /// The numeric hash ID computed from a key.
+  using hash_id = decltype(H::hash_of(std::declval<key_type>()));
+
+  /// Maximum load, as the number of elements per 8 slots.
+  static constexpr size_t MAX_LOAD_EIGHTHS = 7;
+
+protected:
+  /// Storage for an element, which is constructed only if the slot is in use.
+  union Slot {
+    Slot() {}
+    ~Slot() {}
+    T _v;
+  };
+
+  /// Iterator implementation, @a V is @a T for @c iterator and <tt>T const</tt> for @c const_iterator.
+  template<typename V> class iter {
+    using self_type = iter; ///< Self reference type.
+    friend class FlatHashMap;
+    template<typename> friend class iter;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = T;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = V *;
+    using reference         = V&;
+
+    iter() = default;
+
+    /// Allow conversion from @c iterator to @c const_iterator.
+    template<typename U, typename = std::enable_if_t<std::is_same_v<V, U const>>> iter(iter<U> const& that);
+
+    reference operator*() const;
+    pointer operator->() const;
+
+    self_type& operator++();
+    self_type operator++(int);
+
+    bool operator==(self_type const& that) const;
+    bool operator!=(self_type const& that) const;
+
+  protected:
+    iter(int8_t const *ctrl, int8_t const *limit, Slot *slot);
+
+    /// Move forward to the first slot in use, starting at the current slot.
+    void skip();
+
+    int8_t const *_ctrl  = nullptr; ///< Control byte for the current slot.
+    int8_t const *_limit = nullptr; ///< End of the control bytes.
+    Slot *_slot          = nullptr; ///< Current slot.
+  };
+
+public:
+  using iterator       = iter<T>;
+  using const_iterator = iter<T const>;
+
+  /// Construct with room for at least @a n elements without expanding.
+  explicit FlatHashMap(size_t n = 0);
+
+  /// Move constructor.
+  FlatHashMap(self_type&& that);
+
+  /// Move assignment.
+  self_type& operator=(self_type&& that);
+
+  ~FlatHashMap();
+
+  // noncopyable
+  FlatHashMap(self_type const& ) = delete;
+  self_type& operator=(self_type const& ) = delete;
+
+  iterator begin();             ///< First element.
+  const_iterator begin() const; ///< First element.
+  iterator end();               ///< Past last element.
+  const_iterator end() const;   ///< Past last element.
+
+  /** Find the element with a key equal to @a key.
+
+      @return An iterator for the element, or the end iterator if not found.
+  */
+  iterator find(key_type key);
+
+  const_iterator find(key_type key) const;
+
+  /// @return @c true if there is an element with a key equal to @a key.
+  bool contains(key_type key) const;
+
+  /** Insert @a v in to the map.
+
+      @return A pair of an iterator for the element with the key of @a v and a flag which is @c true if
+      @a v was inserted, or @c false if an element with the same key was already in the map.
+   */
+  std::pair<iterator, bool> insert(T const& v);
+
+  std::pair<iterator, bool> insert(T&& v);
+
+  /// Construct an element from @a args and insert it.
+  /// @see insert
+  template<typename... Args> std::pair<iterator, bool> emplace(Args&&... args);
+
+  /// Remove the element with a key equal to @a key.
+  /// @return The number of elements removed.
+  size_t erase(key_type key);
+
+  /// Remove the element at @a loc.
+  void erase(const_iterator const& loc);
+
+  /// Remove all elements.
+  self_type& clear();
+
+  /// Make room for at least @a n elements without expanding.
+  self_type& reserve(size_t n);
+
+  /// Number of elements in the map.
+  size_t count() const;
+
+  /// @return @c true if the map has no elements.
+  bool empty() const;
+
+  /// Number of slots in the map.
+  size_t capacity() const;
+
+protected:
+  std::unique_ptr<int8_t[]> _ctrl; ///< Control bytes.
+  std::unique_ptr<Slot[]> _slots;  ///< Element storage.
+  size_t _capacity = 0;            ///< Number of slots, a power of two multiple of the group size.
+  size_t _count    = 0;            ///< Number of elements.
+  size_t _growth   = 0;            ///< Number of elements that can be added without a rehash.
+
+  /// Key of the element in @a v.
+  static key_type key_of(T const& v);
+
+  /// Hash of @a key, mixed because only a few bits are used for each of the group and control byte.
+  static uint64_t hash_for(key_type key);
+
+  /// Slot index of the element with @a key and hash @a h, or @c _capacity if not found.
+  size_t locate(key_type key, uint64_t h) const;
+
+  /// Slot index of the first free slot in the probe sequence for @a h.
+  size_t find_free(uint64_t h) const;
+
+  /// Set the control byte for slot @a idx to @a c.
+  void set_ctrl(size_t idx, int8_t c);
+
+  /// Insert @a v, which has a key not in the map.
+  template<typename V> iterator insert_new(uint64_t h, V&& v);
+
+  /// Move the elements in to a new table with @a n slots.
+  void rehash(size_t n);
+
+  /// Destroy all elements and mark all slots empty.
+  void destroy_all();
+
+  /// Slot count needed for @a n elements.
+  static size_t capacity_for(size_t n);
+
+  iterator iterator_at(size_t idx);
+};
+
+// --- Iterator
+
+template<typename H, typename T>
+template<typename V>
+FlatHashMap<H, T>::iter<V>::iter(int8_t const *ctrl, int8_t const *limit, Slot *slot) : _ctrl(ctrl), _limit(limit), _slot(slot) {}
+
+template<typename H, typename T>
+template<typename V>
+template<typename U, typename>
+FlatHashMap<H, T>::iter<V>::iter(iter<U> const& that) : _ctrl(that._ctrl), _limit(that._limit), _slot(that._slot) {}
+
+template<typename H, typename T>
+template<typename V>
+void
+FlatHashMap<H, T>::iter<V>::skip() {
+  while (_ctrl < _limit && *_ctrl < 0) {
+    ++_ctrl;
+    ++_slot;
+  }
+}
+
+template<typename H, typename T>
+template<typename V>
+auto
+FlatHashMap<H, T>::iter<V>::operator*() const -> reference {
+  return _slot->_v;
+}
+
+template<typename H, typename T>
+template<typename V>
+auto
+FlatHashMap<H, T>::iter<V>::operator->() const -> pointer {
+  return &_slot->_v;
+}
+
+template<typename H, typename T>
+template<typename V>
+auto
+FlatHashMap<H, T>::iter<V>::operator++() -> self_type& {
+  ++_ctrl;
+  ++_slot;
+  this->skip();
+  return *this;
+}
+
+template<typename H, typename T>
+template<typename V>
+auto
+FlatHashMap<H, T>::iter<V>::operator++(int) -> self_type {
+  self_type zret{*this};
+  ++*this;
+  return zret;
+}
+
+template<typename H, typename T>
+template<typename V>
+bool
+FlatHashMap<H, T>::iter<V>::operator==(self_type const& that) const {
+  return _ctrl == that._ctrl;
+}
+
+template<typename H, typename T>
+template<typename V>
+bool
+FlatHashMap<H, T>::iter<V>::operator!=(self_type const& that) const {
+  return _ctrl != that._ctrl;
+}
+
+// --- Map
+
+template<typename H, typename T> FlatHashMap<H, T>::FlatHashMap(size_t n) {
+  if (n) {
+    this->rehash(capacity_for(n));
+  }
+}
+
+template<typename H, typename T>
+FlatHashMap<H, T>::FlatHashMap(self_type&& that)
+  : _ctrl(std::move(that._ctrl)), _slots(std::move(that._slots)), _capacity(that._capacity), _count(that._count), _growth(that._growth) {
+  that._capacity = that._count = that._growth = 0;
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::operator=(self_type&& that) -> self_type& {
+  if (this != &that) {
+    this->destroy_all();
+    _ctrl          = std::move(that._ctrl);
+    _slots         = std::move(that._slots);
+    _capacity      = that._capacity;
+    _count         = that._count;
+    _growth        = that._growth;
+    that._capacity = that._count = that._growth = 0;
+  }
+  return *this;
+}
+
+template<typename H, typename T> FlatHashMap<H, T>::~FlatHashMap() {
+  this->destroy_all();
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::key_of(T const& v) -> key_type {
+  if constexpr (std::is_pointer_v<T>) {
+    return H::key_of(v);
+  } else {
+    return H::key_of(const_cast<T *>(&v));
+  }
+}
+
+template<typename H, typename T>
+uint64_t
+FlatHashMap<H, T>::hash_for(key_type key) {
+  // MurmurHash3 finalizer - the hash may be weak, such as FNV or an identity hash.
+  uint64_t h = static_cast<uint64_t>(H::hash_of(key));
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+template<typename H, typename T>
+size_t
+FlatHashMap<H, T>::capacity_for(size_t n) {
+  size_t zret = Group::SIZE;
+  while (zret * MAX_LOAD_EIGHTHS / 8 < n) {
+    zret <<= 1;
+  }
+  return zret;
+}
+
+template<typename H, typename T>
+void
+FlatHashMap<H, T>::set_ctrl(size_t idx, int8_t c) {
+  _ctrl[idx] = c;
+}
+
+// The high bits of the hash select the starting group, the low 7 bits are stored in the control byte.
+// Groups are probed with triangular steps, which visits every group because the group count is a power of two.
+template<typename H, typename T>
+size_t
+FlatHashMap<H, T>::locate(key_type key, uint64_t h) const {
+  if (_count == 0) {
+    return _capacity;
+  }
+  size_t mask = _capacity / Group::SIZE - 1;
+  auto h2     = static_cast<int8_t>(h & 0x7F);
+  for (size_t g = (h >> 7) & mask, step = 0; step <= mask; g = (g + ++step) & mask) {
+    size_t base = g * Group::SIZE;
+    Group group{_ctrl.get() + base};
+    for (uint32_t m = group.match(h2); m; m &= m - 1) {
+      size_t idx = base + __builtin_ctz(m);
+      if (H::equal(key, key_of(_slots[idx]._v))) {
+        return idx;
+      }
+    }
+    if (group.match_empty()) { // probing for this key would have stopped here.
+      break;
+    }
+  }
+  return _capacity;
+}
+
+template<typename H, typename T>
+size_t
+FlatHashMap<H, T>::find_free(uint64_t h) const {
+  size_t mask = _capacity / Group::SIZE - 1;
+  for (size_t g = (h >> 7) & mask, step = 0;; g = (g + ++step) & mask) {
+    if (uint32_t m = Group{_ctrl.get() + g * Group::SIZE}.match_free(); m) {
+      return g * Group::SIZE + __builtin_ctz(m);
+    }
+  }
+}
+
+template<typename H, typename T>
+void
+FlatHashMap<H, T>::rehash(size_t n) {
+  std::unique_ptr<int8_t[]> ctrl{new int8_t[n]};
+  std::unique_ptr<Slot[]> slots{new Slot[n]};
+  std::memset(ctrl.get(), Group::EMPTY, n);
+  std::swap(ctrl, _ctrl);
+  std::swap(slots, _slots);
+  auto old_capacity = _capacity;
+  _capacity         = n;
+  _growth           = n * MAX_LOAD_EIGHTHS / 8 - _count;
+
+  for (size_t idx = 0; idx < old_capacity; ++idx) {
+    if (ctrl[idx] >= 0) {
+      T& v      = slots[idx]._v;
+      auto h    = hash_for(key_of(v));
+      auto spot = this->find_free(h);
+      this->set_ctrl(spot, static_cast<int8_t>(h & 0x7F));
+      new (&_slots[spot]._v) T(std::move(v));
+      v.~T();
+    }
+  }
+}
+
+template<typename H, typename T>
+void
+FlatHashMap<H, T>::destroy_all() {
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    for (size_t idx = 0; idx < _capacity; ++idx) {
+      if (_ctrl[idx] >= 0) {
+        _slots[idx]._v.~T();
+      }
+    }
+  }
+  if (_capacity) {
+    std::memset(_ctrl.get(), Group::EMPTY, _capacity);
+  }
+  _count = 0;
+}
+
+template<typename H, typename T>
+template<typename V>
+auto
+FlatHashMap<H, T>::insert_new(uint64_t h, V&& v) -> iterator {
+  if (_growth == 0) {
+    // If much of the table is deleted slots, reclaim those instead of growing.
+    this->rehash(_count < _capacity * MAX_LOAD_EIGHTHS / 16 ? _capacity : std::max(_capacity * 2, Group::SIZE));
+  }
+  auto idx = this->find_free(h);
+  // Reusing a deleted slot doesn't reduce the number of slots left for probing.
+  if (_ctrl[idx] == Group::EMPTY) {
+    --_growth;
+  }
+  this->set_ctrl(idx, static_cast<int8_t>(h & 0x7F));
+  new (&_slots[idx]._v) T(std::forward<V>(v));
+  ++_count;
+  return this->iterator_at(idx);
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::insert(T const& v) -> std::pair<iterator, bool> {
+  auto key = key_of(v);
+  auto h   = hash_for(key);
+  if (auto idx = this->locate(key, h); idx < _capacity) {
+    return {this->iterator_at(idx), false};
+  }
+  return {this->insert_new(h, v), true};
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::insert(T&& v) -> std::pair<iterator, bool> {
+  auto key = key_of(v);
+  auto h   = hash_for(key);
+  if (auto idx = this->locate(key, h); idx < _capacity) {
+    return {this->iterator_at(idx), false};
+  }
+  return {this->insert_new(h, std::move(v)), true};
+}
+
+template<typename H, typename T>
+template<typename... Args>
+auto
+FlatHashMap<H, T>::emplace(Args&&... args) -> std::pair<iterator, bool> {
+  return this->insert(T(std::forward<Args>(args)...));
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::find(key_type key) -> iterator {
+  auto idx = this->locate(key, hash_for(key));
+  return idx < _capacity ? this->iterator_at(idx) : this->end();
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::find(key_type key) const -> const_iterator {
+  return const_cast<self_type *>(this)->find(key);
+}
+
+template<typename H, typename T>
+bool
+FlatHashMap<H, T>::contains(key_type key) const {
+  return this->locate(key, hash_for(key)) < _capacity;
+}
+
+template<typename H, typename T>
+void
+FlatHashMap<H, T>::erase(const_iterator const& loc) {
+  size_t idx = loc._ctrl - _ctrl.get();
+  _slots[idx]._v.~T();
+  --_count;
+  // If the group has an empty slot, no probe continues past it, so this slot can be empty as well.
+  size_t base = idx - idx % Group::SIZE;
+  if (Group{_ctrl.get() + base}.match_empty()) {
+    this->set_ctrl(idx, Group::EMPTY);
+    ++_growth;
+  } else {
+    this->set_ctrl(idx, Group::DELETED);
+  }
+}
+
+template<typename H, typename T>
+size_t
+FlatHashMap<H, T>::erase(key_type key) {
+  if (auto spot = this->find(key); spot != this->end()) {
+    this->erase(spot);
+    return 1;
+  }
+  return 0;
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::clear() -> self_type& {
+  this->destroy_all();
+  _growth = _capacity * MAX_LOAD_EIGHTHS / 8;
+  return *this;
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::reserve(size_t n) -> self_type& {
+  if (auto cap = capacity_for(n); cap > _capacity) {
+    this->rehash(cap);
+  }
+  return *this;
+}
+
+template<typename H, typename T>
+size_t
+FlatHashMap<H, T>::count() const {
+  return _count;
+}
+
+template<typename H, typename T>
+bool
+FlatHashMap<H, T>::empty() const {
+  return _count == 0;
+}
+
+template<typename H, typename T>
+size_t
+FlatHashMap<H, T>::capacity() const {
+  return _capacity;
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::iterator_at(size_t idx) -> iterator {
+  return {_ctrl.get() + idx, _ctrl.get() + _capacity, _slots.get() + idx};
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::begin() -> iterator {
+  iterator zret{this->iterator_at(0)};
+  zret.skip();
+  return zret;
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::begin() const -> const_iterator {
+  return const_cast<self_type *>(this)->begin();
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::end() -> iterator {
+  return this->iterator_at(_capacity);
+}
+
+template<typename H, typename T>
+auto
+FlatHashMap<H, T>::end() const -> const_iterator {
+  return const_cast<self_type *>(this)->end();
+}
+
+}} // namespace swoc
@@ -0,0 +1,399 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+   Direct lookup indices for @c IPSpace.
+
+   These are built from an @c IPSpace and provide lookup with a small, fixed number of memory
+   accesses regardless of the number of ranges in the space.
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "swoc/swoc_version.h"
+#include "swoc/swoc_ip.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+/** Direct lookup index for the IPv4 ranges in an @c IPSpace.
+ *
+ * @tparam PAYLOAD Payload type of the space.
+ *
+ * This uses the "DIR-24-8" layout. The first table is indexed by the upper 24 bits of the address.
+ * Each entry is either the index of the range that contains every address in that /24, or the
+ * index of a second stage group of 256 entries that is indexed by the low 8 bits of the address.
+ * Lookup is therefore one or two memory accesses independent of the number of ranges.
+ *
+ * Addresses are mapped to a compact range index which is 1 based, with 0 meaning "not found".
+ * The payload for each index is copied in to the index, which is independent of the space once
+ * built. The index does not track changes to the space and must be rebuilt with @c rebuild.
+ *
+ * @note The first stage table is 64MB. This is intended for large spaces where lookup speed
+ * matters more than memory.
+ */
+template <typename PAYLOAD> class IP4Index {
+  using self_type = IP4Index; ///< Self reference type.
+
+public:
+  using index_type = uint32_t; ///< Compact range index type.
+
+  /// Index value for addresses not in the space.
+  static constexpr index_type INVALID = 0;
+
+  /// Construct an empty index.
+  IP4Index() = default;
+
+  /** Construct an index for @a space.
+   *
+   * @param space Source space.
+   */
+  template <typename EQUAL> explicit IP4Index(IPSpace<PAYLOAD, EQUAL> const& space) { this->rebuild(space); }
+
+  /** Rebuild the index from @a space.
+   *
+   * @param space Source space.
+   * @return @a this
+   */
+  template <typename EQUAL> self_type& rebuild(IPSpace<PAYLOAD, EQUAL> const& space);
+
+  /// Remove all ranges, freeing the tables.
+  self_type& clear();
+
+  /** Find the range index for @a addr.
+   *
+   * @param addr Address to find.
+   * @return The index of the range that contains @a addr, or @c INVALID if not found.
+   */
+  index_type
+  index(IP4Addr const& addr) const {
+    if (_tbl24.empty()) {
+      return INVALID;
+    }
+    auto host = addr.host_order();
+    auto e    = _tbl24[host >> 8];
+    if (e & GROUP) {
+      e = _tbl8[((e & ~GROUP) << 8) | (host & 0xFF)];
+    }
+    return e;
+  }
+
+  /** Find the payload for @a addr.
+   *
+   * @param addr Address to find.
+   * @return A pointer to the payload, or @c nullptr if @a addr is not in the index.
+   */
+  PAYLOAD const *
+  find(IP4Addr const& addr) const {
+    auto idx = this->index(addr);
+    return idx == INVALID ? nullptr : &_payloads[idx - 1];
+  }
+
+  /** Find the payload for @a addr.
+   *
+   * @param addr Address to find.
+   * @return A pointer to the payload, or @c nullptr if @a addr is not an IPv4 address in the index.
+   */
+  PAYLOAD const *
+  find(IPAddr const& addr) const {
+    return addr.is_ip4() ? this->find(addr.ip4()) : nullptr;
+  }
+
+  /** Get the payload for a range index.
+   *
+   * @param idx Range index, which must not be @c INVALID.
+   * @return The payload for range @a idx.
+   */
+  PAYLOAD const&
+  payload(index_type idx) const {
+    return _payloads[idx - 1];
+  }
+
+  /// @return The number of ranges.
+  size_t
+  count() const {
+    return _payloads.size();
+  }
+
+  /// @return The number of second stage groups.
+  size_t
+  group_count() const {
+    return _tbl8.size() / GROUP_SIZE;
+  }
+
+protected:
+  /// Entry flag for a second stage group.
+  static constexpr index_type GROUP = index_type(1) << 31;
+  /// Number of entries in a second stage group.
+  static constexpr size_t GROUP_SIZE = 256;
+
+  std::vector<index_type> _tbl24;  ///< First stage, indexed by the upper 24 bits.
+  std::vector<index_type> _tbl8;   ///< Second stage groups.
+  std::vector<PAYLOAD> _payloads;  ///< Payloads, by range index.
+};
+
+template <typename PAYLOAD>
+auto
+IP4Index<PAYLOAD>::clear() -> self_type& {
+  // Swap to actually release the memory.
+  std::vector<index_type>().swap(_tbl24);
+  std::vector<index_type>().swap(_tbl8);
+  std::vector<PAYLOAD>().swap(_payloads);
+  return *this;
+}
+
+template <typename PAYLOAD>
+template <typename EQUAL>
+auto
+IP4Index<PAYLOAD>::rebuild(IPSpace<PAYLOAD, EQUAL> const& space) -> self_type& {
+  this->clear();
+  _tbl24.resize(size_t(1) << 24, INVALID);
+  _payloads.reserve(space.count_ip4());
+
+  for (auto spot = space.begin_ip4(), limit = space.end_ip4(); spot != limit; ++spot) {
+    auto const& [range, payload] = *spot;
+    _payloads.push_back(payload);
+    auto idx = index_type(_payloads.size());
+    // 64 bits so that incrementing past the maximum address does not wrap.
+    uint64_t lo = range.min().ip4().host_order();
+    uint64_t hi = range.max().ip4().host_order();
+    while (lo <= hi) {
+      uint64_t block     = lo >> 8;
+      uint64_t block_max = lo | 0xFF;
+      if ((lo & 0xFF) == 0 && block_max <= hi) {
+        // Run of complete blocks.
+        uint64_t limit = (hi + 1) >> 8;
+        std::fill(_tbl24.begin() + block, _tbl24.begin() + limit, idx);
+        lo = limit << 8;
+      } else {
+        // Partial block. Ranges are sorted and disjoint, so if the block already has a group it
+        // must be the last one created.
+        auto& e = _tbl24[block];
+        if (!(e & GROUP)) {
+          e = GROUP | index_type(this->group_count());
+          _tbl8.resize(_tbl8.size() + GROUP_SIZE, INVALID);
+        }
+        auto base = size_t(e & ~GROUP) << 8;
+        auto max  = std::min(hi, block_max);
+        std::fill(_tbl8.begin() + base + (lo & 0xFF), _tbl8.begin() + base + (max & 0xFF) + 1, idx);
+        lo = max + 1;
+      }
+    }
+  }
+  return *this;
+}
+
+/** Direct lookup index for the IPv6 ranges in an @c IPSpace.
+ *
+ * @tparam PAYLOAD Payload type of the space.
+ *
+ * This is a multibit trie. The root table is indexed by the upper 16 bits of the address and each
+ * deeper level by the next 8 bits. An entry is either the index of the range that contains every
+ * address under that entry, or a reference to the next level node. Ranges are put in the trie at
+ * the shallowest levels that exactly cover them, so a range aligned on a prefix (as nearly all
+ * real world IPv6 allocations are) occupies a single entry. A lookup for an address in a /32 is
+ * three memory accesses, in a /48 is five, and in a /64 is seven, each a direct array access
+ * rather than a 128 bit comparison.
+ *
+ * Addresses are mapped to a compact range index which is 1 based, with 0 meaning "not found".
+ * The payload for each index is copied in to the index, which is independent of the space once
+ * built. The index does not track changes to the space and must be rebuilt with @c rebuild.
+ */
+template <typename PAYLOAD> class IP6Index {
+  using self_type = IP6Index; ///< Self reference type.
+
+public:
+  using index_type = uint32_t; ///< Compact range index type.
+
+  /// Index value for addresses not in the space.
+  static constexpr index_type INVALID = 0;
+
+  /// Construct an empty index.
+  IP6Index() = default;
+
+  /** Construct an index for @a space.
+   *
+   * @param space Source space.
+   */
+  template <typename EQUAL> explicit IP6Index(IPSpace<PAYLOAD, EQUAL> const& space) { this->rebuild(space); }
+
+  /** Rebuild the index from @a space.
+   *
+   * @param space Source space.
+   * @return @a this
+   */
+  template <typename EQUAL> self_type& rebuild(IPSpace<PAYLOAD, EQUAL> const& space);
+
+  /// Remove all ranges, freeing the tables.
+  self_type& clear();
+
+  /** Find the range index for @a addr.
+   *
+   * @param addr Address to find.
+   * @return The index of the range that contains @a addr, or @c INVALID if not found.
+   */
+  index_type
+  index(IP6Addr const& addr) const {
+    if (_root.empty()) {
+      return INVALID;
+    }
+    auto msw = addr.msw();
+    auto lsw = addr.lsw();
+    auto e   = _root[msw >> (64 - ROOT_STRIDE)];
+    for (unsigned level = 1; e & NODE; ++level) {
+      e = _nodes[(size_t(e & ~NODE) << STRIDE) | chunk(msw, lsw, level)];
+    }
+    return e;
+  }
+
+  /** Find the payload for @a addr.
+   *
+   * @param addr Address to find.
+   * @return A pointer to the payload, or @c nullptr if @a addr is not in the index.
+   */
+  PAYLOAD const *
+  find(IP6Addr const& addr) const {
+    auto idx = this->index(addr);
+    return idx == INVALID ? nullptr : &_payloads[idx - 1];
+  }
+
+  /** Find the payload for @a addr.
+   *
+   * @param addr Address to find.
+   * @return A pointer to the payload, or @c nullptr if @a addr is not an IPv6 address in the index.
+   */
+  PAYLOAD const *
+  find(IPAddr const& addr) const {
+    return addr.is_ip6() ? this->find(addr.ip6()) : nullptr;
+  }
+
+  /** Get the payload for a range index.
+   *
+   * @param idx Range index, which must not be @c INVALID.
+   * @return The payload for range @a idx.
+   */
+  PAYLOAD const&
+  payload(index_type idx) const {
+    return _payloads[idx - 1];
+  }
+
+  /// @return The number of ranges.
+  size_t
+  count() const {
+    return _payloads.size();
+  }
+
+  /// @return The number of nodes below the root.
+  size_t
+  node_count() const {
+    return _nodes.size() >> STRIDE;
+  }
+
+protected:
+  /// Entry flag for a reference to a node.
+  static constexpr index_type NODE = index_type(1) << 31;
+  /// Number of bits used to index the root.
+  static constexpr unsigned ROOT_STRIDE = 16;
+  /// Number of bits used to index each node below the root.
+  static constexpr unsigned STRIDE = 8;
+  /// Number of entries in a node.
+  static constexpr size_t NODE_SIZE = size_t(1) << STRIDE;
+
+  std::vector<index_type> _root;  ///< Root table.
+  std::vector<index_type> _nodes; ///< Nodes below the root.
+  std::vector<PAYLOAD> _payloads; ///< Payloads, by range index.
+
+  /// @return The bits of the address that index a node at @a level.
+  static unsigned
+  chunk(uint64_t msw, uint64_t lsw, unsigned level) {
+    unsigned bit = ROOT_STRIDE + (level - 1) * STRIDE; // offset of the chunk from the top.
+    return (bit < 64 ? msw >> (64 - STRIDE - bit) : lsw >> (128 - STRIDE - bit)) & (NODE_SIZE - 1);
+  }
+
+  /// @return A mask of the lower @a n bits of a word, @a n must be at most 64.
+  static uint64_t
+  low_mask(unsigned n) {
+    return n >= 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+  }
+
+  /// @return The entry for the block at @a level that starts with @a msw, @a lsw.
+  index_type& entry(uint64_t msw, uint64_t lsw, unsigned level);
+};
+
+template <typename PAYLOAD>
+auto
+IP6Index<PAYLOAD>::clear() -> self_type& {
+  std::vector<index_type>().swap(_root);
+  std::vector<index_type>().swap(_nodes);
+  std::vector<PAYLOAD>().swap(_payloads);
+  return *this;
+}
+
+template <typename PAYLOAD>
+auto
+IP6Index<PAYLOAD>::entry(uint64_t msw, uint64_t lsw, unsigned level) -> index_type& {
+  index_type *e = &_root[msw >> (64 - ROOT_STRIDE)];
+  for (unsigned lvl = 1; lvl <= level; ++lvl) {
+    index_type node;
+    if (*e & NODE) {
+      node = *e & ~NODE;
+    } else { // split the entry - @a e is invalid after resizing.
+      auto prev = *e;
+      node      = index_type(this->node_count());
+      *e        = NODE | node;
+      _nodes.resize(_nodes.size() + NODE_SIZE, prev);
+    }
+    e = &_nodes[(size_t(node) << STRIDE) | chunk(msw, lsw, lvl)];
+  }
+  return *e;
+}
+
+template <typename PAYLOAD>
+template <typename EQUAL>
+auto
+IP6Index<PAYLOAD>::rebuild(IPSpace<PAYLOAD, EQUAL> const& space) -> self_type& {
+  this->clear();
+  _root.resize(size_t(1) << ROOT_STRIDE, INVALID);
+  _payloads.reserve(space.count_ip6());
+
+  for (auto spot = space.begin_ip6(), limit = space.end_ip6(); spot != limit; ++spot) {
+    auto const& [range, payload] = *spot;
+    _payloads.push_back(payload);
+    auto idx  = index_type(_payloads.size());
+    auto lo_h = range.min().ip6().msw();
+    auto lo_l = range.min().ip6().lsw();
+    auto hi_h = range.max().ip6().msw();
+    auto hi_l = range.max().ip6().lsw();
+    while (true) {
+      // Find the shallowest level with a block that starts at @a lo and is inside the range.
+      // This always succeeds at the bottom level where a block is a single address.
+      unsigned level = 0;
+      unsigned bits  = 128 - ROOT_STRIDE; // bits below an entry at @a level.
+      uint64_t max_h, max_l;              // last address in the block.
+      for (;; ++level, bits -= STRIDE) {
+        auto mask_h = low_mask(bits > 64 ? bits - 64 : 0);
+        auto mask_l = low_mask(bits);
+        max_h       = lo_h | mask_h;
+        max_l       = lo_l | mask_l;
+        if ((lo_h & mask_h) == 0 && (lo_l & mask_l) == 0 && (max_h < hi_h || (max_h == hi_h && max_l <= hi_l))) {
+          break;
+        }
+      }
+      this->entry(lo_h, lo_l, level) = idx;
+      if (max_h == hi_h && max_l == hi_l) {
+        break;
+      }
+      // Advance to the next block, which can't overflow because the block max is less than @a hi.
+      lo_h = max_h;
+      lo_l = max_l + 1;
+      if (lo_l == 0) {
+        ++lo_h;
+      }
+    }
+  }
+  return *this;
+}
+
+}} // namespace swoc
@@ -0,0 +1,534 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+    Frozen, flat layout of an @c IPSpace for fast lookup.
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <memory>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "swoc/swoc_version.h"
+#include "swoc/MemSpan.h"
+#include "swoc/MemArena.h"
+#include "swoc/swoc_ip.h"
+#include "swoc/swoc_file.h"
+#include "swoc/Errata.h"
+#include "swoc/bwf_ex.h"
+#include "swoc/bwf_std.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+/** Immutable flat copy of an @c IPSpace.
+ *
+ * @tparam PAYLOAD The payload type of the source @c IPSpace.
+ *
+ * This is intended for the case where an @c IPSpace is built once and then looked up many times.
+ * The ranges of each address family are copied in to contiguous arrays in Eytzinger (breadth
+ * first) order. This keeps the top levels of the implicit search tree in a few cache lines, makes
+ * the memory location of descendants computable so they can be prefetched, and allows a search
+ * without branching on comparison results. This is much friendlier to the cache than walking the
+ * nodes of the @c DiscreteSpace tree.
+ *
+ * Instances are normally created via @c IPSpace::freeze. The view does not track changes to the
+ * source space.
+ *
+ * If @a PAYLOAD is an empty type (e.g. @c std::monostate) no payloads are stored.
+ *
+ * A view can be written to a file with @c store and later loaded with @c map. The file layout is
+ * the same as the in memory layout, therefore loading does no parsing or copying. The file is
+ * mapped read only and shared, so all processes that map the same file share the same physical
+ * memory. This requires @a PAYLOAD to be trivially copyable. The file format is
+ *
+ * - A @c FileHeader. This contains the format identification, the byte order, the size and
+ *   alignment of @a PAYLOAD and a caller supplied payload schema tag.
+ * - For IPv4, then IPv6, the range minimums, the range maximums, and the payloads. Each array starts
+ *   on a @c FILE_ALIGN boundary, at the offset recorded in the @c FileSection for that family. The
+ *   payload table is omitted if @a PAYLOAD is empty.
+ *
+ * All values are in the native byte order of the writer. A file with a different byte order,
+ * version, payload layout, or tag is rejected by @c map.
+ */
+template <typename PAYLOAD> class IPSpaceView {
+  using self_type = IPSpaceView; ///< Self reference type.
+
+public:
+  using payload_t = PAYLOAD; ///< Export payload type.
+
+  /// Construct an empty view.
+  IPSpaceView() = default;
+
+  /** Construct a view of @a space.
+   *
+   * @param space Source space.
+   *
+   * The ranges and payloads are copied from @a space.
+   */
+  template <typename EQUAL> explicit IPSpaceView(IPSpace<PAYLOAD, EQUAL> const& space);
+
+  /// No copying.
+  IPSpaceView(self_type const& that) = delete;
+
+  /// Move constructor.
+  IPSpaceView(self_type&& that);
+
+  /// Destructor.
+  ~IPSpaceView();
+
+  /// No copy assignment.
+  self_type& operator=(self_type const& that) = delete;
+
+  /// Move assignment.
+  self_type& operator=(self_type&& that);
+
+  /** Find the payload for @a addr.
+   *
+   * @param addr Address to find.
+   * @return A pointer to the payload for @a addr, or @c nullptr if @a addr is not in the view.
+   */
+  PAYLOAD const *find(IPAddr const& addr) const;
+
+  /** Find the payload for @a addr.
+   *
+   * @param addr Address to find.
+   * @return A pointer to the payload for @a addr, or @c nullptr if @a addr is not in the view.
+   */
+  PAYLOAD const *find(IP4Addr const& addr) const { return _ip4.find(addr); }
+
+  /** Find the payload for @a addr.
+   *
+   * @param addr Address to find.
+   * @return A pointer to the payload for @a addr, or @c nullptr if @a addr is not in the view.
+   */
+  PAYLOAD const *find(IP6Addr const& addr) const { return _ip6.find(addr); }
+
+  /// @return The number of distinct ranges.
+  size_t count() const { return _ip4._count + _ip6._count; }
+
+  /// @return The number of IPv4 ranges.
+  size_t count_ip4() const { return _ip4._count; }
+
+  /// @return The number of IPv6 ranges.
+  size_t count_ip6() const { return _ip6._count; }
+
+  /// Identification for the file format.
+  static constexpr std::string_view FILE_MAGIC{"SWOCIPSV"};
+  /// Version of the file format.
+  static constexpr uint32_t FILE_VERSION = 1;
+  /// Byte order marker, written in native order.
+  static constexpr uint32_t FILE_BYTE_ORDER = 0x01020304;
+  /// Alignment of arrays in the file.
+  static constexpr size_t FILE_ALIGN = 64;
+
+  /// Location of the arrays for an address family in the file.
+  struct FileSection {
+    uint64_t _count;   ///< Number of ranges.
+    uint64_t _min;     ///< Offset of the range minimums.
+    uint64_t _max;     ///< Offset of the range maximums.
+    uint64_t _payload; ///< Offset of the payloads, 0 if there is no payload table.
+  };
+
+  /// Header at the start of the file.
+  struct FileHeader {
+    char _magic[8];          ///< @c FILE_MAGIC
+    uint32_t _version;       ///< @c FILE_VERSION
+    uint32_t _byte_order;    ///< @c FILE_BYTE_ORDER
+    uint32_t _payload_size;  ///< Size of the payload, 0 if there is no payload table.
+    uint32_t _payload_align; ///< Alignment of the payload.
+    uint64_t _tag;           ///< Payload schema tag.
+    uint64_t _size;          ///< Size of the file.
+    FileSection _ip4;        ///< IPv4 arrays.
+    FileSection _ip6;        ///< IPv6 arrays.
+  };
+
+  /** Write the view to a file.
+   *
+   * @param path Path to the file.
+   * @param tag Payload schema tag.
+   * @return Errors, if any.
+   *
+   * The @a tag is arbitrary and is intended to identify the payload type and its version. It is
+   * checked when the file is loaded by @c map.
+   */
+  Errata store(swoc::file::path const& path, uint64_t tag = 0) const;
+
+  /** Load the view from a file.
+   *
+   * @param path Path to the file.
+   * @param tag Payload schema tag, which must match the tag passed to @c store.
+   * @return Errors, if any.
+   *
+   * The file is mapped in to memory and used directly, lookups are ready immediately. Any previous
+   * contents of @a this are discarded. On failure @a this is empty.
+   */
+  Errata map(swoc::file::path const& path, uint64_t tag = 0);
+
+protected:
+  /** Flat search table for a single address family.
+   *
+   * @tparam METRIC Address type.
+   *
+   * The range minimums are stored in Eytzinger order in @a _min, which is 1 based, so that the
+   * children of the element at index @c k are at @c 2k and @c 2k+1. The range maximums and
+   * payloads are stored in the same order, but 0 based. The arrays are separate so that the
+   * search touches only the minimums.
+   */
+  template <typename METRIC> struct Table {
+    /// Number of tree levels below the current element to prefetch.
+    static constexpr unsigned PREFETCH_LEVELS = 4;
+
+    size_t _count = 0;         ///< Number of ranges.
+    MemSpan<METRIC> _min;      ///< Range minimums, Eytzinger order, 1 based.
+    MemSpan<METRIC> _max;      ///< Range maximums, Eytzinger order, 0 based.
+    MemSpan<PAYLOAD> _payload; ///< Range payloads, Eytzinger order, 0 based.
+
+    /** Search for @a addr.
+     *
+     * @param addr Address to find.
+     * @return The 1 based index of the range containing @a addr, or 0 if not found.
+     */
+    size_t search(METRIC const& addr) const;
+
+    /// @return The payload for @a addr, or @c nullptr if not found.
+    PAYLOAD const *find(METRIC const& addr) const;
+
+    /** Load the table from a sorted sequence of ranges.
+     *
+     * @param arena Memory for the table.
+     * @param spot Iterator for the first range.
+     * @param n Number of ranges.
+     */
+    template <typename ITER> void load(MemArena& arena, ITER spot, size_t n);
+
+    /// Recursive in order fill of the tree.
+    template <typename ITER> void fill(size_t k, ITER& spot);
+
+    /// Set up the section for @a this table in a file, starting at @a offset.
+    size_t layout(FileSection& sect, size_t offset) const;
+
+    /// Point @a this table at a file section in memory @a mem.
+    bool attach(FileSection const& sect, MemSpan<void> mem);
+
+    /// Destroy the payloads.
+    void destroy();
+  };
+
+  /// Discard the current contents.
+  void reset();
+
+  Table<IP4Addr> _ip4;   ///< IPv4 ranges.
+  Table<IP6Addr> _ip6;   ///< IPv6 ranges.
+  MemArena _arena;       ///< Storage for the tables.
+  MemSpan<void> _mapped; ///< File mapping, if loaded from a file.
+};
+
+// --- Implementation
+
+template <typename PAYLOAD>
+template <typename METRIC>
+size_t
+IPSpaceView<PAYLOAD>::Table<METRIC>::search(METRIC const& addr) const {
+  auto const *keys = _min.data();
+  size_t k         = 1;
+  // Go right if the minimum is at or before @a addr. The bits in @a k record the path.
+  while (k <= _count) {
+    __builtin_prefetch(keys + (k << PREFETCH_LEVELS));
+    k = 2 * k + (keys[k] <= addr);
+  }
+  // The last right turn was at the range with the largest minimum at or before @a addr. Strip
+  // off the trailing left turns and that right turn. Yields 0 if there were no right turns.
+  k >>= __builtin_ffsll(static_cast<long long>(k));
+  return (k && addr <= _max[k - 1]) ? k : 0;
+}
+
+template <typename PAYLOAD>
+template <typename METRIC>
+PAYLOAD const *
+IPSpaceView<PAYLOAD>::Table<METRIC>::find(METRIC const& addr) const {
+  auto k = this->search(addr);
+  if constexpr (std::is_empty_v<PAYLOAD>) {
+    static const PAYLOAD EMPTY{};
+    return k ? &EMPTY : nullptr;
+  } else {
+    return k ? &_payload[k - 1] : nullptr;
+  }
+}
+
+template <typename PAYLOAD>
+template <typename METRIC>
+template <typename ITER>
+void
+IPSpaceView<PAYLOAD>::Table<METRIC>::fill(size_t k, ITER& spot) {
+  if (k <= _count) {
+    this->fill(2 * k, spot);
+    auto&& [range, payload]{*spot};
+    new (&_min[k]) METRIC(static_cast<METRIC>(range.min()));
+    new (&_max[k - 1]) METRIC(static_cast<METRIC>(range.max()));
+    if constexpr (!std::is_empty_v<PAYLOAD>) {
+      new (&_payload[k - 1]) PAYLOAD(payload);
+    }
+    ++spot;
+    this->fill(2 * k + 1, spot);
+  }
+}
+
+template <typename PAYLOAD>
+template <typename METRIC>
+template <typename ITER>
+void
+IPSpaceView<PAYLOAD>::Table<METRIC>::load(MemArena& arena, ITER spot, size_t n) {
+  _count = n;
+  if (n) {
+    _min     = arena.alloc_span<METRIC>(n + 1);
+    _max     = arena.alloc_span<METRIC>(n);
+    if constexpr (!std::is_empty_v<PAYLOAD>) {
+      _payload = arena.alloc_span<PAYLOAD>(n);
+    }
+    new (&_min[0]) METRIC(); // Never used, but keep it initialized.
+    this->fill(1, spot);
+  }
+}
+
+template <typename PAYLOAD>
+template <typename METRIC>
+size_t
+IPSpaceView<PAYLOAD>::Table<METRIC>::layout(FileSection& sect, size_t offset) const {
+  auto align = [](size_t n) { return (n + FILE_ALIGN - 1) & ~(FILE_ALIGN - 1); };
+  sect._count   = _count;
+  sect._min     = offset;
+  sect._max     = align(sect._min + (_count + 1) * sizeof(METRIC));
+  sect._payload = std::is_empty_v<PAYLOAD> ? 0 : align(sect._max + _count * sizeof(METRIC));
+  return align(sect._payload ? sect._payload + _count * sizeof(PAYLOAD) : sect._max + _count * sizeof(METRIC));
+}
+
+template <typename PAYLOAD>
+template <typename METRIC>
+bool
+IPSpaceView<PAYLOAD>::Table<METRIC>::attach(FileSection const& sect, MemSpan<void> mem) {
+  // Verify the arrays are inside the file and aligned.
+  auto valid = [&](uint64_t offset, size_t size, size_t align) {
+    return offset % align == 0 && offset <= mem.size() && size <= mem.size() - offset;
+  };
+  if (sect._count >= mem.size() || !valid(sect._min, (sect._count + 1) * sizeof(METRIC), alignof(METRIC)) ||
+      !valid(sect._max, sect._count * sizeof(METRIC), alignof(METRIC))) {
+    return false;
+  }
+  if constexpr (!std::is_empty_v<PAYLOAD>) {
+    if (!valid(sect._payload, sect._count * sizeof(PAYLOAD), alignof(PAYLOAD))) {
+      return false;
+    }
+    _payload = mem.subspan(sect._payload, sect._count * sizeof(PAYLOAD)).template rebind<PAYLOAD>();
+  }
+  _count = sect._count;
+  _min   = mem.subspan(sect._min, (_count + 1) * sizeof(METRIC)).template rebind<METRIC>();
+  _max   = mem.subspan(sect._max, _count * sizeof(METRIC)).template rebind<METRIC>();
+  return true;
+}
+
+template <typename PAYLOAD>
+template <typename METRIC>
+void
+IPSpaceView<PAYLOAD>::Table<METRIC>::destroy() {
+  if constexpr (!std::is_trivially_destructible_v<PAYLOAD>) {
+    for (auto& payload : _payload) {
+      std::destroy_at(&payload);
+    }
+  }
+  _payload.clear();
+  _min.clear();
+  _max.clear();
+  _count = 0;
+}
+
+template <typename PAYLOAD>
+template <typename EQUAL>
+IPSpaceView<PAYLOAD>::IPSpaceView(IPSpace<PAYLOAD, EQUAL> const& space) {
+  // Allocate all the memory at once.
+  _arena.require(space.count_ip4() * (2 * sizeof(IP4Addr) + sizeof(PAYLOAD)) +
+                 space.count_ip6() * (2 * sizeof(IP6Addr) + sizeof(PAYLOAD)) + sizeof(IP4Addr) +
+                 sizeof(IP6Addr));
+  _ip4.load(_arena, space.begin_ip4(), space.count_ip4());
+  _ip6.load(_arena, space.begin_ip6(), space.count_ip6());
+}
+
+template <typename PAYLOAD>
+IPSpaceView<PAYLOAD>::IPSpaceView(self_type&& that)
+  : _ip4(that._ip4), _ip6(that._ip6), _arena(std::move(that._arena)), _mapped(that._mapped) {
+  that._ip4 = Table<IP4Addr>{};
+  that._ip6 = Table<IP6Addr>{};
+  that._mapped.clear();
+}
+
+template <typename PAYLOAD>
+auto
+IPSpaceView<PAYLOAD>::operator=(self_type&& that) -> self_type& {
+  if (this != &that) {
+    this->reset();
+    _ip4      = that._ip4;
+    _ip6      = that._ip6;
+    _arena    = std::move(that._arena);
+    _mapped   = that._mapped;
+    that._ip4 = Table<IP4Addr>{};
+    that._ip6 = Table<IP6Addr>{};
+    that._mapped.clear();
+  }
+  return *this;
+}
+
+template <typename PAYLOAD> IPSpaceView<PAYLOAD>::~IPSpaceView() {
+  this->reset();
+}
+
+template <typename PAYLOAD>
+void
+IPSpaceView<PAYLOAD>::reset() {
+  if (_mapped) {
+    // Payloads in the file are trivially destructible.
+    ::munmap(_mapped.data(), _mapped.size());
+    _mapped.clear();
+    _ip4 = Table<IP4Addr>{};
+    _ip6 = Table<IP6Addr>{};
+  } else {
+    _ip4.destroy();
+    _ip6.destroy();
+  }
+  _arena.clear();
+}
+
+template <typename PAYLOAD>
+Errata
+IPSpaceView<PAYLOAD>::store(swoc::file::path const& path, uint64_t tag) const {
+  static_assert(std::is_trivially_copyable_v<PAYLOAD>, "IPSpaceView payload must be trivially copyable to be stored.");
+  FileHeader hdr;
+  std::memset(&hdr, 0, sizeof(hdr));
+  std::memcpy(hdr._magic, FILE_MAGIC.data(), sizeof(hdr._magic));
+  hdr._version       = FILE_VERSION;
+  hdr._byte_order    = FILE_BYTE_ORDER;
+  hdr._payload_size  = std::is_empty_v<PAYLOAD> ? 0 : sizeof(PAYLOAD);
+  hdr._payload_align = alignof(PAYLOAD);
+  hdr._tag           = tag;
+  auto offset        = _ip4.layout(hdr._ip4, (sizeof(FileHeader) + FILE_ALIGN - 1) & ~(FILE_ALIGN - 1));
+  hdr._size          = _ip6.layout(hdr._ip6, offset);
+
+  auto fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  if (fd < 0) {
+    return Errata().error(R"(Failed to open "{}" for IPSpace output - {})", path, bwf::Errno{});
+  }
+
+  size_t written = 0; // position in the file.
+  // Write @a n bytes from @a data starting at @a offset, zero filling any gap.
+  auto emit = [&](uint64_t offset, void const *data, size_t n) -> bool {
+    static constexpr char ZERO[FILE_ALIGN] = {0};
+    while (written < offset) {
+      auto k = ::write(fd, ZERO, std::min<size_t>(sizeof(ZERO), offset - written));
+      if (k <= 0) {
+        return false;
+      }
+      written += k;
+    }
+    auto src = static_cast<char const *>(data);
+    while (n > 0) {
+      auto k = ::write(fd, src, n);
+      if (k <= 0) {
+        return false;
+      }
+      src     += k;
+      n       -= k;
+      written += k;
+    }
+    return true;
+  };
+  auto emit_table = [&](FileSection const& sect, auto const& table) -> bool {
+    if (table._count == 0) { // no arrays allocated - write the sentinel explicitly.
+      using metric_type = typename std::remove_reference_t<decltype(table._min)>::value_type;
+      metric_type sentinel{};
+      return emit(sect._min, &sentinel, sizeof(sentinel));
+    }
+    return emit(sect._min, table._min.data(), table._min.size()) && emit(sect._max, table._max.data(), table._max.size()) &&
+           (sect._payload == 0 || emit(sect._payload, table._payload.data(), table._payload.size()));
+  };
+
+  bool ok = emit(0, &hdr, sizeof(hdr)) && emit_table(hdr._ip4, _ip4) && emit_table(hdr._ip6, _ip6) && emit(hdr._size, nullptr, 0);
+  Errata errata;
+  if (!ok) {
+    errata.error(R"(Failed to write IPSpace output "{}" - {} of {} bytes written - {})", path, written, hdr._size, bwf::Errno{});
+  }
+  ::close(fd);
+  return errata;
+}
+
+template <typename PAYLOAD>
+Errata
+IPSpaceView<PAYLOAD>::map(swoc::file::path const& path, uint64_t tag) {
+  static_assert(std::is_trivially_copyable_v<PAYLOAD>, "IPSpaceView payload must be trivially copyable to be mapped.");
+  this->reset();
+
+  std::error_code ec;
+  auto stat = swoc::file::status(path, ec);
+  if (ec) {
+    return Errata().error(R"(Unable to access IPSpace file "{}" - {})", path, ec);
+  }
+  size_t fsize = swoc::file::file_size(stat);
+  if (fsize < sizeof(FileHeader)) {
+    return Errata().error(R"(IPSpace file "{}" is too small - {} bytes)", path, fsize);
+  }
+
+  auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return Errata().error(R"(Failed to open IPSpace file "{}" - {})", path, bwf::Errno{});
+  }
+  auto mem = ::mmap(nullptr, fsize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // mapping persists without the descriptor.
+  if (mem == MAP_FAILED) {
+    return Errata().error(R"(Failed to map IPSpace file "{}" - {})", path, bwf::Errno{});
+  }
+  _mapped.assign(mem, fsize);
+
+  Errata errata;
+  auto hdr = static_cast<FileHeader const *>(mem);
+  if (FILE_MAGIC != std::string_view(hdr->_magic, sizeof(hdr->_magic))) {
+    errata.error(R"("{}" is not an IPSpace file.)", path);
+  } else if (hdr->_byte_order != FILE_BYTE_ORDER) {
+    errata.error(R"(IPSpace file "{}" has the wrong byte order.)", path);
+  } else if (hdr->_version != FILE_VERSION) {
+    errata.error(R"(IPSpace file "{}" is version {}, version {} is required.)", path, hdr->_version, FILE_VERSION);
+  } else if (hdr->_payload_size != (std::is_empty_v<PAYLOAD> ? 0 : sizeof(PAYLOAD)) || hdr->_payload_align != alignof(PAYLOAD)) {
+    errata.error(R"(IPSpace file "{}" payload size {} align {} does not match the required size {} align {}.)", path,
+                 hdr->_payload_size, hdr->_payload_align, sizeof(PAYLOAD), alignof(PAYLOAD));
+  } else if (hdr->_tag != tag) {
+    errata.error(R"(IPSpace file "{}" payload tag {} does not match the required tag {}.)", path, hdr->_tag, tag);
+  } else if (hdr->_size != fsize || !_ip4.attach(hdr->_ip4, _mapped) || !_ip6.attach(hdr->_ip6, _mapped)) {
+    errata.error(R"(IPSpace file "{}" is corrupt.)", path);
+  }
+
+  if (!errata.is_ok()) {
+    this->reset();
+  }
+  return errata;
+}
+
+template <typename PAYLOAD>
+PAYLOAD const *
+IPSpaceView<PAYLOAD>::find(IPAddr const& addr) const {
+  if (addr.is_ip4()) {
+    return _ip4.find(addr.ip4());
+  } else if (addr.is_ip6()) {
+    return _ip6.find(addr.ip6());
+  }
+  return nullptr;
+}
+
+template <typename PAYLOAD, typename EQUAL>
+auto
+IPSpace<PAYLOAD, EQUAL>::freeze() const -> IPSpaceView<PAYLOAD> {
+  return IPSpaceView<PAYLOAD>{*this};
+}
+
+}} // namespace swoc
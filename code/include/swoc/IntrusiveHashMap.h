@@ -13,11 +13,119 @@
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <cstdint>
+#include <type_traits>
 
 #include "swoc/swoc_version.h"
 #include "swoc/IntrusiveDList.h"
 
 namespace swoc { inline namespace SWOC_VERSION_NS {
+/** Bucket sizing policies for @c IntrusiveHashMap.
+
+    A policy determines the number of buckets and how a hash value is reduced to a bucket index. It
+    must provide these static methods.
+
+    - <tt>size_t initial(size_t n)</tt> returns the bucket count for a requested count of @a n.
+
+    - <tt>size_t next(size_t n)</tt> returns a larger bucket count than @a n, for expansion.
+
+    - <tt>size_t index(ID hash, size_t n)</tt> returns the bucket index in <tt>[0, n)</tt> for @a hash.
+ */
+namespace bucket_sizing {
+/// Prime bucket counts, reduced by remainder. This is the default.
+struct Prime {
+  /// Hash table size prime list.
+  static constexpr std::array<size_t, 29> PRIME = {{1, 3, 7, 13, 31, 61, 127, 251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139, 524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393, 67108859, 134217689, 268435399, 536870909}};
+
+  static size_t initial(size_t n) { return *std::lower_bound(PRIME.begin(), PRIME.end(), n); }
+
+  static size_t next(size_t n) { return *std::lower_bound(PRIME.begin(), PRIME.end(), n + 1); }
+
+  template<typename ID> static size_t index(ID hash, size_t n) { return hash % n; }
+};
+
+/** Power of two bucket counts, reduced by masking.
+
+    @tparam MIX_P Mix the hash bits before masking.
+
+    Masking uses only the low bits of the hash, which is a problem for weak hashes such as FNV or
+    an identity hash of pointers. Mixing should be disabled only if the low bits of the hash are
+    well distributed.
+ */
+template<bool MIX_P = true> struct PowerOfTwo {
+  static size_t initial(size_t n) {
+    size_t zret = 1;
+    while (zret < n) {
+      zret <<= 1;
+    }
+    return zret;
+  }
+
+  static size_t next(size_t n) { return n ? n << 1 : 1; }
+
+  template<typename ID> static size_t index(ID hash, size_t n) {
+    uint64_t h = static_cast<uint64_t>(hash);
+    if constexpr (MIX_P) { // MurmurHash3 finalizer.
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+    }
+    return h & (n - 1);
+  }
+};
+
+/** Any bucket count, reduced by multiplication ("fastrange").
+
+    The index is the high part of the product of the hash and the bucket count. This uses the high
+    bits of the hash, which must therefore be well distributed across the full width of the hash type.
+ */
+struct FastRange {
+  static size_t initial(size_t n) { return n ? n : 1; }
+
+  static size_t next(size_t n) { return n ? n << 1 : 1; }
+
+  template<typename ID> static size_t index(ID hash, size_t n) {
+    if constexpr (sizeof(ID) <= sizeof(uint32_t)) {
+      return (static_cast<uint64_t>(static_cast<uint32_t>(hash)) * n) >> 32;
+    } else {
+      return multiply_high(static_cast<uint64_t>(hash), n);
+    }
+  }
+
+  /// The high 64 bits of the 128 bit product of @a a and @a b.
+  static uint64_t multiply_high(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    return (static_cast<unsigned __int128>(a) * b) >> 64;
+#else
+    uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+  }
+};
+} // namespace bucket_sizing
+
+namespace detail {
+/// Use @c H::bucket_sizing if it is defined, otherwise @c bucket_sizing::Prime.
+template<typename H, typename = void> struct IHMBucketSizing {
+  using type = bucket_sizing::Prime;
+};
+
+template<typename H> struct IHMBucketSizing<H, std::void_t<typename H::bucket_sizing>> {
+  using type = typename H::bucket_sizing;
+};
+
+/// Check if @a H has the method @c cached_hash for @a V.
+template<typename H, typename V, typename = void> struct IHMCachedHash : std::false_type {};
+
+template<typename H, typename V>
+struct IHMCachedHash<H, V, std::void_t<decltype(H::cached_hash(static_cast<V *>(nullptr)))>> : std::true_type {};
+} // namespace detail
+
 /** Intrusive Hash Table.
 
     Values stored in this container are not destroyed when the container is destroyed or removed from the container.
@@ -33,6 +141,13 @@ namespace swoc { inline namespace SWOC_VERSION_NS {
     @see @c setExpansionLimit()
     @see @c expand()
 
+    Expansion normally moves every element to the new bucket array at once, which can be a noticeable
+    delay for a large table. If an expansion step is set, the previous bucket array is kept and only
+    that many buckets are moved to the new array on each insert. Until all of the buckets have been
+    moved, lookups check the previous array as well. Elements with equal keys are always kept in the
+    same array.
+    @see @c set_expansion_step()
+
     The hash table is configured by a descriptor class. This must contain the following members
 
     - The static method <tt>key_type key_of(value_type *)</tt> which returns the key for an instance of @c value_type.
@@ -45,6 +160,14 @@ namespace swoc { inline namespace SWOC_VERSION_NS {
 
     - The static method <tt>value_type *& prev_ptr(value_type *)</tt> which returns a reference to a backwards pointer.
 
+    The descriptor may also define the type @c bucket_sizing as one of the policies in @c swoc::bucket_sizing to
+    control the bucket count and how a hash is reduced to a bucket. If not defined, @c bucket_sizing::Prime is used.
+
+    The descriptor may also define the static method <tt>hash_id & cached_hash(value_type *)</tt> which returns a
+    reference to storage in the element for its hash value. If defined, the map stores the hash there on insert and
+    uses it instead of hashing the key again, in particular during expansion. Hashes are also compared before keys
+    when searching a bucket. The storage must not be changed by the client while the element is in the map.
+
     These are the required members, it is permitted to have other methods (if the descriptor is used for other purposes)
     or to provide overloads of the methods. Note this is compatible with @c IntrusiveDList.
 
@@ -81,6 +204,10 @@ public:
   using key_type = decltype(H::key_of(static_cast<value_type *>(nullptr)));
   /// The numeric hash ID computed from a key.
   using hash_id = decltype(H::hash_of(H::key_of(static_cast<value_type *>(nullptr))));
+  /// Bucket sizing policy.
+  using sizing_type = typename detail::IHMBucketSizing<H>::type;
+  /// Whether hash values are cached in the elements.
+  static constexpr bool HASH_CACHED_P = detail::IHMCachedHash<H, value_type>::value;
 
   /// When the hash table is expanded.
   enum ExpansionPolicy {
@@ -120,8 +247,8 @@ protected:
     /// This is the value of the next bucket, or @c nullptr if no next bucket.
     value_type *limit() const;
 
-    /// Verify @a v is in this bucket.
-    bool contains(value_type *v) const;
+    /// Verify @a v is in this bucket, which ends at @a limit.
+    bool contains(value_type *v, value_type *limit) const;
 
     void clear(); ///< Reset to initial state.
   };
@@ -284,6 +411,24 @@ public:
   /// Set the limit value for the expansion policy.
   size_t get_expansion_limit() const;
 
+  /** Set the number of buckets moved per insert during an expansion.
+
+      If this is zero (the default) an expansion moves all of the elements immediately.
+   */
+  self_type& set_expansion_step(size_t n);
+
+  /// Get the number of buckets moved per insert during an expansion.
+  size_t get_expansion_step() const;
+
+  /// @return @c true if an incremental expansion is in progress.
+  bool is_expanding() const;
+
+  /** Move up to @a n buckets from the previous bucket array during an incremental expansion.
+
+      This can be used to finish an expansion while the map is otherwise idle.
+   */
+  self_type& migrate(size_t n);
+
 protected:
   /// The type of storage for the buckets.
   using Table = std::vector<Bucket>;
@@ -294,8 +439,39 @@ protected:
   /// List of non-empty buckets.
   IntrusiveDList<typename Bucket::Linkage> _active_buckets;
 
+  /// Buckets being emptied by an incremental expansion.
+  /// All elements in these buckets are before the elements in @a _table in @a _list.
+  Table _old_table;
+  /// List of non-empty buckets in @a _old_table.
+  IntrusiveDList<typename Bucket::Linkage> _old_active;
+  size_t _expansion_step{0}; ///< Buckets moved per insert during an expansion.
+
   Bucket *bucket_for(key_type key);
 
+  /// The bucket for the hash @a id.
+  Bucket *bucket_for_hash(hash_id id);
+
+  /// The bucket in @a table for the hash @a id.
+  static Bucket *bucket_for(Table& table, hash_id id);
+
+  /// The hash of the key of @a v, which must be in the map if the hash is cached.
+  static hash_id hash_for(value_type *v);
+
+  /// Check if the key of @a v is @a key, which has hash @a id.
+  static bool match(value_type *v, key_type key, hash_id id);
+
+  /// Compute the limit value for iteration in bucket @a b.
+  value_type *limit_for(Bucket const *b) const;
+
+  /// The active bucket list that contains @a b.
+  IntrusiveDList<typename Bucket::Linkage>& active_for(Bucket *b);
+
+  /// Insert @a v with @a key in to @a bucket in @a _table.
+  void insert_into(Bucket *bucket, key_type key, hash_id id, value_type *v);
+
+  /// Move the elements in @a b from @a _old_table to @a _table.
+  void migrate_bucket(Bucket *b);
+
   ExpansionPolicy _expansion_policy{DEFAULT_EXPANSION_POLICY}; ///< When to exand the table.
   size_t _expansion_limit{DEFAULT_EXPANSION_LIMIT};            ///< Limit value for expansion.
 
@@ -303,9 +479,6 @@ protected:
   IntrusiveHashMap(const IntrusiveHashMap&) = delete;
 
   IntrusiveHashMap& operator=(const IntrusiveHashMap&) = delete;
-
-  // Hash table size prime list.
-  static constexpr std::array<size_t, 29> PRIME = {{1, 3, 7, 13, 31, 61, 127, 251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139, 524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393, 67108859, 134217689, 268435399, 536870909}};
 };
 
 template<typename H>
@@ -341,9 +514,8 @@ IntrusiveHashMap<H>::Bucket::clear() {
 
 template<typename H>
 bool
-IntrusiveHashMap<H>::Bucket::contains(value_type *v) const {
+IntrusiveHashMap<H>::Bucket::contains(value_type *v, value_type *limit) const {
   value_type *x = _v;
-  value_type *limit = this->limit();
   while (x != limit && x != v) {
     x = H::next_ptr(x);
   }
@@ -379,14 +551,74 @@ IntrusiveHashMap<H>::const_range::end() const -> const_iterator const& {
 
 template<typename H> IntrusiveHashMap<H>::IntrusiveHashMap(size_t n) {
   if (n) {
-    _table.resize(*std::lower_bound(PRIME.begin(), PRIME.end(), n));
+    _table.resize(sizing_type::initial(n));
   }
 }
 
 template<typename H>
 auto
 IntrusiveHashMap<H>::bucket_for(key_type key) -> Bucket * {
-  return &_table[H::hash_of(key) % _table.size()];
+  return this->bucket_for_hash(H::hash_of(key));
+}
+
+template<typename H>
+auto
+IntrusiveHashMap<H>::bucket_for_hash(hash_id id) -> Bucket * {
+  // If the old bucket for @a key hasn't been moved, that's where any elements with that key are.
+  if (!_old_active.empty()) {
+    Bucket *b = bucket_for(_old_table, id);
+    if (b->_v) {
+      return b;
+    }
+  }
+  return bucket_for(_table, id);
+}
+
+template<typename H>
+auto
+IntrusiveHashMap<H>::bucket_for(Table& table, hash_id id) -> Bucket * {
+  return &table[sizing_type::index(id, table.size())];
+}
+
+template<typename H>
+auto
+IntrusiveHashMap<H>::hash_for(value_type *v) -> hash_id {
+  if constexpr (HASH_CACHED_P) {
+    return H::cached_hash(v);
+  } else {
+    return H::hash_of(H::key_of(v));
+  }
+}
+
+template<typename H>
+bool
+IntrusiveHashMap<H>::match(value_type *v, key_type key, [[maybe_unused]] hash_id id) {
+  if constexpr (HASH_CACHED_P) {
+    if (H::cached_hash(v) != id) {
+      return false;
+    }
+  }
+  return H::equal(key, H::key_of(v));
+}
+
+template<typename H>
+auto
+IntrusiveHashMap<H>::limit_for(Bucket const *b) const -> value_type * {
+  // The last old bucket ends at the first element of the current table.
+  if (!_old_active.empty() && b == _old_active.tail()) {
+    Bucket const *head = _active_buckets.head();
+    return head ? head->_v : nullptr;
+  }
+  return b->limit();
+}
+
+template<typename H>
+auto
+IntrusiveHashMap<H>::active_for(Bucket *b) -> IntrusiveDList<typename Bucket::Linkage>& {
+  if (!_old_table.empty() && _old_table.data() <= b && b < _old_table.data() + _old_table.size()) {
+    return _old_active;
+  }
+  return _active_buckets;
 }
 
 template<typename H>
@@ -422,16 +654,19 @@ IntrusiveHashMap<H>::clear() -> self_type& {
   // Clear container data.
   _list.clear();
   _active_buckets.clear();
+  _old_active.clear();
+  _old_table = Table{};
   return *this;
 }
 
 template<typename H>
 auto
 IntrusiveHashMap<H>::find(key_type key) -> iterator {
-  Bucket *b = this->bucket_for(key);
+  auto id = H::hash_of(key);
+  Bucket *b = this->bucket_for_hash(id);
   value_type *v = b->_v;
-  value_type *limit = b->limit();
-  while (v != limit && !H::equal(key, H::key_of(v))) {
+  value_type *limit = this->limit_for(b);
+  while (v != limit && !match(v, key, id)) {
     v = H::next_ptr(v);
   }
   return v == limit ? _list.end() : _list.iterator_for(v);
@@ -478,8 +713,8 @@ IntrusiveHashMap<H>::iterator_for(value_type *v) -> iterator {
 template<typename H>
 auto
 IntrusiveHashMap<H>::find(value_type *v) -> iterator {
-  Bucket *b = this->bucket_for(H::key_of(v));
-  return b->contains(v) ? _list.iterator_for(v) : this->end();
+  Bucket *b = this->bucket_for_hash(hash_for(v));
+  return b->contains(v, this->limit_for(b)) ? _list.iterator_for(v) : this->end();
 }
 
 template<typename H>
@@ -492,7 +727,33 @@ template<typename H>
 void
 IntrusiveHashMap<H>::insert(value_type *v) {
   auto key = H::key_of(v);
-  Bucket *bucket = this->bucket_for(key);
+  auto id = H::hash_of(key);
+  if constexpr (HASH_CACHED_P) {
+    H::cached_hash(v) = id;
+  }
+
+  if (!_old_active.empty()) {
+    // Move the old bucket for @a key first so that equal keys are never split between tables.
+    Bucket *b = bucket_for(_old_table, id);
+    if (b->_v) {
+      this->migrate_bucket(b);
+    }
+    this->migrate(_expansion_step);
+  }
+
+  Bucket *bucket = bucket_for(_table, id);
+  this->insert_into(bucket, key, id, v);
+
+  // auto expand if appropriate.
+  if ((AVERAGE == _expansion_policy && (_list.count() / _table.size()) > _expansion_limit) ||
+      (MAXIMUM == _expansion_policy && bucket->_count > _expansion_limit && bucket->_mixed_p)) {
+    this->expand();
+  }
+}
+
+template<typename H>
+void
+IntrusiveHashMap<H>::insert_into(Bucket *bucket, key_type key, hash_id id, value_type *v) {
   value_type *spot = bucket->_v;
   bool mixed_p = false; // Found a different key in the bucket.
 
@@ -501,10 +762,10 @@ IntrusiveHashMap<H>::insert(value_type *v) {
     bucket->_v = v;
     _active_buckets.append(bucket);
   } else {
-    value_type *limit = bucket->limit();
+    value_type *limit = this->limit_for(bucket);
 
     // First search the bucket to see if the key is already in it.
-    while (spot != limit && !H::equal(key, H::key_of(spot))) {
+    while (spot != limit && !match(spot, key, id)) {
       spot = H::next_ptr(spot);
     }
     if (spot != bucket->_v) {
@@ -512,7 +773,7 @@ IntrusiveHashMap<H>::insert(value_type *v) {
     }
     if (spot != limit) {
       // If an equal key was found, walk past those to insert at the upper end of the range.
-      do { spot = H::next_ptr(spot); } while (spot != limit && H::equal(key, H::key_of(spot)));
+      do { spot = H::next_ptr(spot); } while (spot != limit && match(spot, key, id));
       if (spot != limit) { // something not equal past last equivalent, it's going to be mixed.
         mixed_p = true;
       }
@@ -525,12 +786,6 @@ IntrusiveHashMap<H>::insert(value_type *v) {
     bucket->_mixed_p = mixed_p;
   }
   ++bucket->_count;
-
-  // auto expand if appropriate.
-  if ((AVERAGE == _expansion_policy && (_list.count() / _table.size()) > _expansion_limit) ||
-      (MAXIMUM == _expansion_policy && bucket->_count > _expansion_limit && bucket->_mixed_p)) {
-    this->expand();
-  }
 }
 
 template<typename H>
@@ -538,12 +793,12 @@ auto
 IntrusiveHashMap<H>::erase(iterator const& loc) -> iterator {
   value_type *v = loc;
   iterator zret = ++(this->iterator_for(v)); // get around no const_iterator -> iterator.
-  Bucket *b = this->bucket_for(H::key_of(v));
+  Bucket *b = this->bucket_for_hash(hash_for(v));
   value_type *nv = H::next_ptr(v);
-  value_type *limit = b->limit();
+  value_type *limit = this->limit_for(b);
   if (b->_v == v) { // removed first element in bucket, update bucket
     if (limit == nv) { // that was also the only element, deactivate bucket
-      _active_buckets.erase(b);
+      this->active_for(b).erase(b);
       b->clear();
     } else {
       b->_v = nv;
@@ -629,22 +884,66 @@ IntrusiveHashMap<H>::apply(F&& f) -> self_type& {
 template<typename H>
 void
 IntrusiveHashMap<H>::expand() {
-  ExpansionPolicy org_expansion_policy = _expansion_policy; // save for restore.
-  value_type *old = _list.head();      // save for repopulating.
+  this->migrate(_old_active.count()); // finish any previous expansion.
+
   auto old_size = _table.size();
+  if (_expansion_step) {
+    // Keep the current buckets, the elements are moved as the map is updated.
+    if (!_list.empty()) {
+      _old_table = std::move(_table);
+      _old_active = std::move(_active_buckets);
+      _table = Table{};
+    }
+    _table.resize(sizing_type::next(old_size));
+    return;
+  }
+
+  value_type *old = _list.head(); // save for repopulating.
 
   // Reset to empty state.
   this->clear();
-  _table.resize(*std::lower_bound(PRIME.begin(), PRIME.end(), old_size + 1));
+  _table.resize(sizing_type::next(old_size));
 
-  _expansion_policy = MANUAL; // disable any auto expand while we're expanding.
+  // Insert directly, to avoid auto expansion and to use cached hash values.
   while (old) {
     value_type *v = old;
     old = H::next_ptr(old);
-    this->insert(v);
+    auto id = hash_for(v);
+    this->insert_into(bucket_for(_table, id), H::key_of(v), id, v);
+  }
+}
+
+template<typename H>
+void
+IntrusiveHashMap<H>::migrate_bucket(Bucket *b) {
+  value_type *v = b->_v;
+  value_type *limit = this->limit_for(b);
+  // Moved elements are appended, so the end of the bucket must be found before moving any.
+  value_type *last = limit ? H::prev_ptr(limit) : _list.tail();
+  _old_active.erase(b);
+  b->clear();
+
+  bool done_p = false;
+  while (!done_p) {
+    value_type *next = H::next_ptr(v);
+    done_p = (v == last);
+    _list.erase(v);
+    auto id = hash_for(v);
+    this->insert_into(bucket_for(_table, id), H::key_of(v), id, v);
+    v = next;
+  }
+}
+
+template<typename H>
+auto
+IntrusiveHashMap<H>::migrate(size_t n) -> self_type& {
+  while (n-- > 0 && !_old_active.empty()) {
+    this->migrate_bucket(_old_active.head());
   }
-  // stashed array gets cleaned up when @a tmp goes out of scope.
-  _expansion_policy = org_expansion_policy; // reset to original value.
+  if (_old_active.empty() && !_old_table.empty()) {
+    _old_table = Table{};
+  }
+  return *this;
 }
 
 template<typename H>
@@ -685,4 +984,23 @@ IntrusiveHashMap<H>::get_expansion_limit() const {
   return _expansion_limit;
 }
 
+template<typename H>
+auto
+IntrusiveHashMap<H>::set_expansion_step(size_t n) -> self_type& {
+  _expansion_step = n;
+  return *this;
+}
+
+template<typename H>
+size_t
+IntrusiveHashMap<H>::get_expansion_step() const {
+  return _expansion_step;
+}
+
+template<typename H>
+bool
+IntrusiveHashMap<H>::is_expanding() const {
+  return !_old_active.empty();
+}
+
 }} // namespace swoc
@@ -356,15 +356,21 @@ protected:
     struct NameLinkage {
       Item *_next{nullptr};
       Item *_prev{nullptr};
+      uint32_t _hash{0}; ///< Cached hash of the name.
 
       static Item *& next_ptr(Item *);
 
       static Item *& prev_ptr(Item *);
 
+      static uint32_t& cached_hash(Item *);
+
       static std::string_view key_of(Item *);
 
       static uint32_t hash_of(std::string_view s);
 
+      /// FNV has weak low bits, mix before masking.
+      using bucket_sizing = swoc::bucket_sizing::PowerOfTwo<true>;
+
       static bool equal(std::string_view const& lhs, std::string_view const& rhs);
     } _name_link;
 
@@ -381,6 +387,9 @@ protected:
 
       static uintmax_t hash_of(E);
 
+      /// The hash is the value, which may be sparse (e.g. bit flags), so mix before masking.
+      using bucket_sizing = swoc::bucket_sizing::PowerOfTwo<true>;
+
       static bool equal(E lhs, E rhs);
     } _value_link;
   };
@@ -443,6 +452,12 @@ Lexicon<E>::Item::ValueLinkage::key_of(Item *item) {
   return item->_value;
 }
 
+template<typename E>
+uint32_t&
+Lexicon<E>::Item::NameLinkage::cached_hash(Item *item) {
+  return item->_name_link._hash;
+}
+
 template<typename E>
 uint32_t
 Lexicon<E>::Item::NameLinkage::hash_of(std::string_view s) {
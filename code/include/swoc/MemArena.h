@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <new>
 #include <mutex>
 #include <memory>
@@ -17,6 +19,11 @@
 #include "swoc/Scalar.h"
 #include "swoc/IntrusiveDList.h"
 
+/// Enable @c MemArena statistics. This must be the same for all compilation units.
+#if !defined(SWOC_ARENA_STATS)
+#define SWOC_ARENA_STATS 0
+#endif
+
 namespace swoc { inline namespace SWOC_VERSION_NS {
 /** A memory arena.
 
@@ -30,6 +37,66 @@ class MemArena {
   using self_type = MemArena; ///< Self reference type.
 
 public:
+  /** Source of memory for internal blocks.
+   *
+   * The arena gets memory for its internal blocks from a provider and returns that memory to the
+   * same provider when the block is no longer needed. The provider must outlive every arena that
+   * uses it.
+   *
+   * @see MallocBlockProvider
+   * @see MmapBlockProvider
+   * @see RegionBlockProvider
+   */
+  class BlockProvider {
+  public:
+    virtual ~BlockProvider() = default;
+
+    /** Allocate memory for a block.
+     *
+     * @param n Minimum number of bytes.
+     * @return The memory, or an empty span if the memory is not available.
+     *
+     * The returned memory must be at least @a n bytes and aligned at least as strictly as
+     * @c std::max_align_t. It may be larger than @a n, in which case the arena will use all of it.
+     */
+    virtual MemSpan<void> allocate(size_t n) = 0;
+
+    /** Release memory for a block.
+     *
+     * @param span Memory previously returned from @c allocate.
+     */
+    virtual void release(MemSpan<void> span) = 0;
+  };
+
+  /// @return The default block provider, which uses @c malloc.
+  static BlockProvider& default_provider();
+
+  /// @c true if statistics are gathered, which is controlled by @c SWOC_ARENA_STATS.
+  static constexpr bool STATS_ENABLED = SWOC_ARENA_STATS;
+
+  /** Cumulative statistics for an arena.
+   *
+   * These are gathered only if @c SWOC_ARENA_STATS is enabled, otherwise they are always zero.
+   */
+  struct Stats {
+    /// Number of buckets in the allocation size histogram.
+    static constexpr unsigned N_BUCKETS = 16;
+
+    size_t blocks_created = 0; ///< Number of blocks created.
+    size_t blocks_freed   = 0; ///< Number of blocks released.
+    size_t allocations    = 0; ///< Number of allocations.
+    size_t requested      = 0; ///< Bytes requested by allocations, not including alignment.
+    size_t reserved       = 0; ///< Bytes of free space in created blocks.
+    size_t waste          = 0; ///< Bytes left unallocated in blocks when the blocks became full.
+    size_t peak_allocated = 0; ///< Maximum value of @c allocated_size.
+    /// Allocation size histogram. Bucket @a k counts sizes in [2^(k-1), 2^k), bucket 0 counts empty
+    /// allocations, and the last bucket counts all larger sizes.
+    std::array<size_t, N_BUCKETS> histogram{};
+
+    /// @return The histogram bucket for an allocation of @a n bytes.
+    static unsigned bucket(size_t n);
+  };
+
   /// Simple internal arena block of memory. Maintains the underlying memory.
   struct Block {
     /// A block must have at least this much free space to not be "full".
@@ -50,9 +117,19 @@ public:
     /** Allocate @a n bytes from this block.
      *
      * @param n Number of bytes to allocate.
+     * @param align Alignment of the allocated memory, which must be a power of 2.
      * @return The span of memory allocated.
+     *
+     * Bytes skipped to align the memory are counted as allocated.
      */
-    MemSpan<void> alloc(size_t n);
+    MemSpan<void> alloc(size_t n, size_t align = 1);
+
+    /** Padding required for alignment.
+     *
+     * @param align Alignment, which must be a power of 2.
+     * @return The number of bytes to skip in the remnant for @a align alignment.
+     */
+    size_t padding(size_t align) const;
 
     /** Discard allocations.
      *
@@ -76,15 +153,8 @@ public:
   protected:
     friend MemArena;
 
-    /** Override @c operator @c delete.
-     *
-     * This is required because the allocated memory size is larger than the class size which
-     * requires calling @c free directly, skipping the destructor and avoiding complaints about size
-     * mismatches.
-     *
-     * @param ptr Memory to be de-allocated.
-     */
-    static void operator delete(void * ptr) noexcept;
+    /// @return The memory for the block, including this instance.
+    MemSpan<void> span();
 
     /** Override placement (non-allocated) @c delete.
      *
@@ -92,6 +162,7 @@ public:
      * @param place Value passed to @c new.
      *
      * This is called only when the class constructor throws an exception during placement new.
+     * The memory is owned by the block provider and is not released here.
      *
      * @note I think the parameters are described correctly, the documentation I can find is a bit
      * vague on the source of these values. It is required even if the constructor is marked @c
@@ -126,6 +197,44 @@ public:
 
   using BlockList = IntrusiveDList<Block::Linkage>;
 
+  /** A point in the allocation history of an arena, for rolling back allocations.
+   *
+   * While any checkpoint exists the arena allocates in stack order - allocation is done only from
+   * the most recent block or a new block. This makes rollback proportional to the number of blocks
+   * released, at the cost of not using free space in older blocks until all checkpoints are
+   * destroyed.
+   *
+   * @see MemArena::checkpoint
+   * @see MemArena::rollback
+   */
+  class Checkpoint {
+    using self_type = Checkpoint; ///< Self reference type.
+  public:
+    /// Move constructor.
+    Checkpoint(self_type&& that);
+
+    /// No copying.
+    Checkpoint(self_type const&) = delete;
+    /// No assignment.
+    self_type& operator=(self_type const&) = delete;
+    /// No assignment.
+    self_type& operator=(self_type&&) = delete;
+
+    /// Destructor - this does not roll back the arena.
+    ~Checkpoint();
+
+  protected:
+    friend MemArena;
+
+    /// Constructor.
+    explicit Checkpoint(MemArena * arena);
+
+    MemArena *_arena;         ///< Arena, @c nullptr if moved from.
+    Block *_block;            ///< Active block at the checkpoint, @c nullptr if there was none.
+    size_t _offset;           ///< Allocated bytes in @a _block.
+    size_t _active_allocated; ///< Allocated bytes in the arena.
+  };
+
   /** Construct with reservation hint.
    *
    * No memory is initially reserved, but when memory is needed this will be done so at least
@@ -141,6 +250,15 @@ public:
    */
   explicit MemArena(size_t n = DEFAULT_BLOCK_SIZE);
 
+  /** Construct with a block provider and a reservation hint.
+   *
+   * @param provider Source of memory for internal blocks.
+   * @param n Minimum number of available bytes in the first internally reserved block.
+   *
+   * @a provider must outlive this instance.
+   */
+  explicit MemArena(BlockProvider& provider, size_t n = DEFAULT_BLOCK_SIZE);
+
   /// no copying
   MemArena(self_type const& that) = delete;
 
@@ -177,6 +295,16 @@ public:
    */
   static self_type *construct_self_contained(size_t n = DEFAULT_BLOCK_SIZE);
 
+  /** Make a self-contained instance that uses @a provider.
+   *
+   * @param provider Source of memory for internal blocks.
+   * @param n The initial memory size hint.
+   * @return A new, self contained instance.
+   *
+   * @see construct_self_contained(size_t)
+   */
+  static self_type *construct_self_contained(BlockProvider& provider, size_t n = DEFAULT_BLOCK_SIZE);
+
   /** Allocate @a n bytes of storage.
 
       Returns a span of memory within the arena. alloc() is self expanding but DOES NOT self
@@ -184,9 +312,26 @@ public:
       @a n bytes.
 
       @param n number of bytes to allocate.
+      @param align Alignment of the allocated memory, which must be a power of 2.
       @return a MemSpan of the allocated memory.
+
+      By default there is no alignment, which is best for data such as strings. Any bytes skipped
+      to align the memory are counted as allocated.
    */
-  MemSpan<void> alloc(size_t n);
+  MemSpan<void> alloc(size_t n, size_t align = 1);
+
+  /** Grow the most recent allocation in place.
+   *
+   * @param span The most recent allocation.
+   * @param n The new size in bytes.
+   * @return The extended span, or an empty span if it could not be extended.
+   *
+   * The allocation can be extended only if no other allocation has been made after it and there
+   * is enough free space after it in its block. If @a n is not larger than the size of @a span,
+   * @a span is returned. The memory is never moved - if the allocation cannot be extended, the
+   * caller must allocate new memory and copy.
+   */
+  MemSpan<void> extend(MemSpan<void> span, size_t n);
 
   /** ALlocate a span of memory sufficient for @a n instance of @a T.
    *
@@ -196,6 +341,7 @@ public:
    *
    * The instances are @b not initialized / constructed. This only allocates the memory.
    * This is handy for types that don't need initialization, such as built in types like @c int.
+   * The memory is aligned for @a T.
    * @code
    *   auto vec = arena.alloc_span<int>(20); // allocate space for 20 ints
    * @endcode
@@ -240,6 +386,33 @@ public:
    */
   self_type& thaw();
 
+  /** Mark the current allocation point.
+   *
+   * @return A checkpoint for use with @c rollback.
+   *
+   * @code
+   * auto mark = arena.checkpoint();
+   * if (!try_parse(arena)) {
+   *   arena.rollback(mark); // discard everything allocated by the failed parse.
+   * }
+   * @endcode
+   *
+   * Checkpoints can be nested. A checkpoint is invalidated by rolling back to an earlier checkpoint,
+   * or by freezing, clearing, or discarding the arena, and must then not be used except to be
+   * destroyed. The arena must not be moved while a checkpoint exists.
+   */
+  Checkpoint checkpoint();
+
+  /** Roll back to @a mark.
+   *
+   * @param mark Checkpoint from this arena.
+   * @return @a this
+   *
+   * All memory allocated after @a mark was created is released, including any blocks created
+   * after @a mark. The checkpoint remains valid and can be rolled back to again.
+   */
+  self_type& rollback(Checkpoint const& mark);
+
   /** Release all memory.
 
       Empties the entire arena and deallocates all underlying memory. The hint for the next reserved
@@ -278,12 +451,14 @@ public:
   /** Require @a n bytes of contiguous memory.
    *
    * @param n Number of bytes.
+   * @param align Alignment of the memory, which must be a power of 2.
    * @return @a this
    *
-   * This forces the @c remnant to be at least @a n bytes of contiguous memory. A subsequent
-   * @c alloc will use this space if the allocation size is at most the remnant size.
+   * This forces the @c remnant to be at least @a n bytes of contiguous memory after skipping bytes
+   * for @a align alignment. A subsequent @c alloc with the same alignment will use this space if
+   * the allocation size is at most @a n.
    */
-  self_type& require(size_t n);
+  self_type& require(size_t n, size_t align = 1);
 
   /// @returns the total number of bytes allocated within the arena.
   size_t allocated_size() const;
@@ -300,6 +475,12 @@ public:
    */
   size_t reserved_size() const;
 
+  /// @return The block provider for this arena.
+  BlockProvider& provider() const;
+
+  /// @return Cumulative statistics for this arena.
+  Stats const& stats() const;
+
   using const_iterator = BlockList::const_iterator;
   using iterator       = const_iterator; // only const iteration allowed on blocks.
 
@@ -321,6 +502,15 @@ protected:
    */
   Block *make_block(size_t n);
 
+  /** Release the memory for @a block.
+   *
+   * @param provider Provider that allocated the memory.
+   * @param block Block to release.
+   *
+   * This is static so that it can be used safely in the destructor of a self contained arena.
+   */
+  static void release_block(BlockProvider& provider, Block *block);
+
   /// Clean up the frozen list.
   void destroy_frozen();
 
@@ -346,6 +536,15 @@ protected:
   /// This is not zero iff @c reserve was called.
   size_t _reserve_hint = 0;
 
+  BlockProvider *_provider = &default_provider(); ///< Source of block memory.
+
+  /// Number of existing checkpoints. If not zero, allocation is in stack order.
+  unsigned _checkpoint_count = 0;
+
+#if SWOC_ARENA_STATS
+  Stats _stats; ///< Cumulative statistics.
+#endif
+
   BlockList _frozen; ///< Previous generation, frozen memory.
   BlockList _active; ///< Current generation. Allocate here.
 
@@ -354,6 +553,180 @@ protected:
   // marks the last block to check. This keeps the set of blocks to check short.
 };
 
+/** Block provider that uses @c malloc.
+ *
+ * This is the default provider for @c MemArena. Blocks can be aligned more strictly than
+ * @c malloc provides, e.g. to cache lines so that blocks used by different threads do not share
+ * cache lines.
+ * @code
+ *   static MallocBlockProvider Cache_Line_Blocks{64};
+ *   MemArena arena{Cache_Line_Blocks};
+ * @endcode
+ */
+class MallocBlockProvider : public MemArena::BlockProvider {
+  using self_type = MallocBlockProvider; ///< Self reference type.
+public:
+  /** Constructor.
+   *
+   * @param align Alignment of blocks, which must be a power of 2. The block sizes are rounded up
+   * to a multiple of this.
+   */
+  explicit MallocBlockProvider(size_t align = alignof(std::max_align_t));
+
+  MemSpan<void> allocate(size_t n) override;
+
+  void release(MemSpan<void> span) override;
+
+protected:
+  size_t _align; ///< Block alignment.
+};
+
+/** Block provider that uses anonymous memory maps.
+ *
+ * Memory is obtained directly from the operating system with @c mmap, bypassing @c malloc. Sizes
+ * are rounded up to the page size. Huge pages can be used to reduce TLB pressure for large arenas.
+ *
+ * - @c Pages::SMALL - use normal pages.
+ * - @c Pages::ADVISE - blocks of at least the huge page size are aligned to the huge page size and
+ *   marked with @c madvise(MADV_HUGEPAGE) so that transparent huge pages are used if enabled.
+ * - @c Pages::HUGETLB - blocks are mapped with @c MAP_HUGETLB and rounded up to the huge page size. If
+ *   no huge pages are available this falls back to @c Pages::ADVISE.
+ *
+ * Huge page support is Linux specific, on other systems normal pages are always used.
+ */
+class MmapBlockProvider : public MemArena::BlockProvider {
+  using self_type = MmapBlockProvider; ///< Self reference type.
+public:
+  /// Type of pages to use.
+  enum class Pages {
+    SMALL, ///< Normal pages.
+    ADVISE, ///< Transparent huge pages.
+    HUGETLB ///< Explicit huge pages.
+  };
+
+  /// Default huge page size.
+  static constexpr size_t HUGE_PAGE_SIZE = 1 << 21;
+
+  /** Constructor.
+   *
+   * @param pages Type of pages to use.
+   * @param huge_page_size Size of huge pages.
+   */
+  explicit MmapBlockProvider(Pages pages = Pages::SMALL, size_t huge_page_size = HUGE_PAGE_SIZE);
+
+  MemSpan<void> allocate(size_t n) override;
+
+  void release(MemSpan<void> span) override;
+
+  /// @return The type of pages used.
+  Pages pages() const;
+
+protected:
+  /// Map at least @a n bytes aligned to @a align, trimming any excess.
+  static MemSpan<void> map_aligned(size_t n, size_t align);
+
+  Pages _pages; ///< Type of pages to use.
+  size_t _page_size; ///< System page size.
+  size_t _huge_page_size; ///< Huge page size.
+};
+
+/** Block provider that uses a caller supplied region of memory.
+ *
+ * Blocks are sliced off the front of the region. Memory released by the most recently allocated
+ * block is reused, and the entire region is reused when all blocks have been released. If there is
+ * not enough memory left in the region the allocation fails and the arena throws
+ * @c std::bad_alloc.
+ *
+ * This is not thread safe and must not be shared between arenas used in different threads.
+ */
+class RegionBlockProvider : public MemArena::BlockProvider {
+  using self_type = RegionBlockProvider; ///< Self reference type.
+public:
+  /** Constructor.
+   *
+   * @param region Memory to use for blocks. This must outlive the provider.
+   */
+  explicit RegionBlockProvider(MemSpan<void> region);
+
+  MemSpan<void> allocate(size_t n) override;
+
+  void release(MemSpan<void> span) override;
+
+  /// @return The amount of the region still available.
+  size_t remaining() const;
+
+protected:
+  static constexpr size_t ALIGN = alignof(std::max_align_t); ///< Slice alignment.
+
+  MemSpan<void> _region; ///< Memory not yet allocated.
+  char * _base = nullptr; ///< Start of the region.
+  size_t _count = 0; ///< Number of slices outstanding.
+};
+
+/** Block provider that caches released blocks for reuse.
+ *
+ * Released blocks are kept, sorted by size, up to a limit on the total retained bytes and are used
+ * for later allocations instead of going to the underlying provider. Blocks that do not fit in the
+ * cache are released to the underlying provider. This removes the underlying allocation cost for
+ * arenas that are repeatedly cleared or thawed, such as arenas for a single request.
+ *
+ * The cache is not thread safe. It can be used for a single arena, or for all the arenas in a
+ * thread by making it @c thread_local.
+ * @code
+ *   thread_local CachingBlockProvider Block_Cache{1 << 20};
+ *   MemArena arena{Block_Cache};
+ * @endcode
+ */
+class CachingBlockProvider : public MemArena::BlockProvider {
+  using self_type = CachingBlockProvider; ///< Self reference type.
+public:
+  /** Constructor.
+   *
+   * @param max_retained Maximum number of bytes to keep in the cache.
+   * @param provider Underlying provider.
+   */
+  explicit CachingBlockProvider(size_t max_retained, MemArena::BlockProvider& provider = MemArena::default_provider());
+
+  CachingBlockProvider(self_type const&) = delete;
+  self_type& operator=(self_type const&) = delete;
+
+  /// Release all cached blocks.
+  ~CachingBlockProvider() override;
+
+  MemSpan<void> allocate(size_t n) override;
+
+  void release(MemSpan<void> span) override;
+
+  /// Release all cached blocks to the underlying provider.
+  self_type& clear();
+
+  /// @return The number of bytes in cached blocks.
+  size_t retained() const;
+
+  /// @return The number of cached blocks.
+  size_t count() const;
+
+protected:
+  /// Cached block, stored in the block memory.
+  struct Item {
+    size_t _size; ///< Size of the block.
+    Item * _next; ///< Next larger block.
+  };
+
+  MemArena::BlockProvider& _provider; ///< Underlying provider.
+  size_t _max_retained; ///< Limit on cached bytes.
+  size_t _retained = 0; ///< Cached bytes.
+  size_t _count = 0; ///< Number of cached blocks.
+  Item * _head = nullptr; ///< Cached blocks, in increasing size.
+};
+
+class BufferWriter;
+namespace bwf {
+struct Spec;
+}
+
+BufferWriter& bwformat(BufferWriter& w, bwf::Spec const& spec, MemArena::Stats const& stats);
+
 /** Arena of a specific type on top of a @c MemArena.
  *
  * @tparam T Type in the arena.
@@ -431,10 +804,16 @@ inline bool MemArena::Block::is_full() const {
   return this->remaining() < MIN_FREE_SPACE;
 }
 
-inline MemSpan<void> MemArena::Block::alloc(size_t n) {
-  if (n > this->remaining()) {
+inline size_t MemArena::Block::padding(size_t align) const {
+  return -reinterpret_cast<uintptr_t>(this->data() + allocated) & (align - 1);
+}
+
+inline MemSpan<void> MemArena::Block::alloc(size_t n, size_t align) {
+  auto pad = this->padding(align);
+  if (n + pad > this->remaining()) {
     throw (std::invalid_argument{"MemArena::Block::alloc size is more than remaining."});
   }
+  allocated += pad;
   MemSpan<void> zret = this->remnant().prefix(n);
   allocated += n;
   return zret;
@@ -442,15 +821,17 @@ inline MemSpan<void> MemArena::Block::alloc(size_t n) {
 
 template<typename T>
 MemSpan<T> MemArena::alloc_span(size_t n) {
-  return this->alloc(sizeof(T) * n).rebind<T>();
+  return this->alloc(sizeof(T) * n, alignof(T)).template rebind<T>();
 }
 
 template<typename T, typename... Args> T *MemArena::make(Args&& ... args) {
-  return new(this->alloc(sizeof(T)).data()) T(std::forward<Args>(args)...);
+  return new(this->alloc(sizeof(T), alignof(T)).data()) T(std::forward<Args>(args)...);
 }
 
 inline MemArena::MemArena(size_t n) : _reserve_hint(n) {}
 
+inline MemArena::MemArena(BlockProvider& provider, size_t n) : _reserve_hint(n), _provider(&provider) {}
+
 inline MemSpan<void> MemArena::Block::remnant() {
   return {this->data() + allocated, this->remaining()};
 }
@@ -460,8 +841,11 @@ inline MemArena::Block& MemArena::Block::discard() {
   return *this;
 }
 
-inline void MemArena::Block::operator delete(void *ptr) noexcept { ::free(ptr); }
-inline void MemArena::Block::operator delete([[maybe_unused]] void * ptr, void * place) noexcept { ::free(place); }
+inline MemSpan<void> MemArena::Block::span() {
+  return {this, sizeof(*this) + size};
+}
+
+inline void MemArena::Block::operator delete([[maybe_unused]] void * ptr, [[maybe_unused]] void * place) noexcept {}
 
 inline size_t MemArena::size() const {
   return _active_allocated;
@@ -483,6 +867,49 @@ inline size_t MemArena::reserved_size() const {
   return _active_reserved + _frozen_reserved;
 }
 
+inline unsigned MemArena::Stats::bucket(size_t n) {
+  unsigned zret = 0;
+  while (n && zret < N_BUCKETS - 1) {
+    ++zret;
+    n >>= 1;
+  }
+  return zret;
+}
+
+inline auto MemArena::stats() const -> Stats const& {
+#if SWOC_ARENA_STATS
+  return _stats;
+#else
+  static const Stats zret;
+  return zret;
+#endif
+}
+
+inline MemArena::Checkpoint::Checkpoint(MemArena *arena)
+    : _arena(arena), _block(arena->_active.head()), _offset(_block ? _block->allocated : 0)
+      , _active_allocated(arena->_active_allocated) {
+  ++_arena->_checkpoint_count;
+}
+
+inline MemArena::Checkpoint::Checkpoint(self_type&& that)
+    : _arena(that._arena), _block(that._block), _offset(that._offset), _active_allocated(that._active_allocated) {
+  that._arena = nullptr;
+}
+
+inline MemArena::Checkpoint::~Checkpoint() {
+  if (_arena) {
+    --_arena->_checkpoint_count;
+  }
+}
+
+inline auto MemArena::checkpoint() -> Checkpoint {
+  return Checkpoint{this};
+}
+
+inline auto MemArena::provider() const -> BlockProvider& {
+  return *_provider;
+}
+
 inline auto MemArena::begin() const -> const_iterator {
   return _active.begin();
 }
@@ -499,6 +926,22 @@ inline auto MemArena::frozen_end() const -> const_iterator {
   return _frozen.end();
 }
 
+inline auto MmapBlockProvider::pages() const -> Pages {
+  return _pages;
+}
+
+inline size_t RegionBlockProvider::remaining() const {
+  return _region.size();
+}
+
+inline size_t CachingBlockProvider::retained() const {
+  return _retained;
+}
+
+inline size_t CachingBlockProvider::count() const {
+  return _count;
+}
+
 template<typename T> FixedArena<T>::FixedArena(MemArena& arena) : _arena(arena) {
   static_assert(sizeof(T) >= sizeof(T *));
 }
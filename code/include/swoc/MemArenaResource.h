@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+   Polymorphic memory resource adapter for @c MemArena.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+
+#include "swoc/swoc_version.h"
+#include "swoc/MemArena.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+/** A @c std::pmr::memory_resource that allocates from a @c MemArena.
+ *
+ * This enables standard containers to allocate from an arena.
+ * @code
+ * MemArena arena;
+ * MemArenaResource resource{arena};
+ * std::pmr::unordered_map<std::pmr::string, int> map{&resource};
+ * @endcode
+ *
+ * Deallocated memory of small sizes is kept on free lists by size class and reused by later
+ * allocations. This works well with node based containers that repeatedly allocate and release
+ * nodes of the same size. Other deallocated memory is not reused until the arena is cleared.
+ *
+ * The free lists are in arena memory, therefore if the arena is cleared directly the free lists
+ * must also be dropped with @c drop_free_lists. @c release does both. Containers using the
+ * resource must be destroyed before the arena is cleared, because deallocation writes to the
+ * memory being deallocated.
+ *
+ * This is not thread safe.
+ */
+class MemArenaResource : public std::pmr::memory_resource {
+  using self_type  = MemArenaResource;          ///< Self reference type.
+  using super_type = std::pmr::memory_resource; ///< Parent type.
+
+public:
+  /// Size classes are multiples of this.
+  static constexpr size_t SIZE_CLASS = alignof(std::max_align_t);
+  /// Largest size of memory that is recycled.
+  static constexpr size_t MAX_RECYCLE_SIZE = 512;
+
+  /** Construct on @a arena.
+   *
+   * @param arena Source of memory. This must outlive the resource.
+   */
+  explicit MemArenaResource(MemArena& arena);
+
+  /// No copying.
+  MemArenaResource(self_type const&) = delete;
+  /// No copy assignment.
+  self_type& operator=(self_type const&) = delete;
+
+  /// @return The arena used by this resource.
+  MemArena& arena() const;
+
+  /** Release all memory.
+   *
+   * The free lists are dropped and the arena is cleared.
+   *
+   * @return @a this
+   */
+  self_type& release();
+
+  /** Drop the free lists.
+   *
+   * @return @a this
+   *
+   * This must be called if the arena is cleared, discarded, or thawed other than by @c release.
+   */
+  self_type& drop_free_lists();
+
+protected:
+  /// Free list item, overlaid on released memory.
+  struct Item {
+    Item *_next; ///< Next free item.
+  };
+
+  /// Number of free lists.
+  static constexpr size_t N_LISTS = MAX_RECYCLE_SIZE / SIZE_CLASS;
+
+  /// @return The free list index for @a n bytes, which must be in (0, MAX_RECYCLE_SIZE].
+  static size_t list_index(size_t n);
+
+  void *do_allocate(size_t n, size_t align) override;
+
+  void do_deallocate(void *ptr, size_t n, size_t align) override;
+
+  bool do_is_equal(super_type const& that) const noexcept override;
+
+  MemArena& _arena;                       ///< Memory source.
+  std::array<Item *, N_LISTS> _free{};   ///< Free lists by size class.
+};
+
+// --- Implementation
+
+inline MemArenaResource::MemArenaResource(MemArena& arena) : _arena(arena) {}
+
+inline MemArena&
+MemArenaResource::arena() const {
+  return _arena;
+}
+
+inline auto
+MemArenaResource::drop_free_lists() -> self_type& {
+  _free.fill(nullptr);
+  return *this;
+}
+
+inline auto
+MemArenaResource::release() -> self_type& {
+  this->drop_free_lists();
+  _arena.clear();
+  return *this;
+}
+
+inline size_t
+MemArenaResource::list_index(size_t n) {
+  return (n - 1) / SIZE_CLASS;
+}
+
+inline void *
+MemArenaResource::do_allocate(size_t n, size_t align) {
+  if (0 < n && n <= MAX_RECYCLE_SIZE && align <= SIZE_CLASS) {
+    auto idx = list_index(n);
+    if (Item *item = _free[idx]; item) {
+      _free[idx] = item->_next;
+      return item;
+    }
+    // Allocate the full size class so the memory can be reused by any size in the class.
+    return _arena.alloc((idx + 1) * SIZE_CLASS, SIZE_CLASS).data();
+  }
+  return _arena.alloc(n, align).data();
+}
+
+inline void
+MemArenaResource::do_deallocate(void *ptr, size_t n, size_t align) {
+  if (0 < n && n <= MAX_RECYCLE_SIZE && align <= SIZE_CLASS) {
+    auto idx   = list_index(n);
+    _free[idx] = new (ptr) Item{_free[idx]};
+  }
+}
+
+inline bool
+MemArenaResource::do_is_equal(super_type const& that) const noexcept {
+  return this == &that;
+}
+
+}} // namespace swoc
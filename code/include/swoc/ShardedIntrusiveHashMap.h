@@ -0,0 +1,323 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+  Intrusive hash map partitioned in to independently locked shards.
+
+  A wrapper for @c IntrusiveHashMap for tables that are shared by many threads. Each element is in
+  one of a fixed number of shards, selected by the hash of its key. Each shard is an
+  @c IntrusiveHashMap with its own lock, so threads working on different shards do not contend.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+
+#include "swoc/swoc_version.h"
+#include "swoc/IntrusiveHashMap.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+/** Intrusive hash map with independently locked shards.
+
+    @tparam H The descriptor, as for @c IntrusiveHashMap.
+    @tparam N The number of shards.
+
+    The elements are linked exactly as for @c IntrusiveHashMap, which is used for each shard. Lookups
+    take a shared lock on the shard for the key, and updates an exclusive lock. @c count is computed
+    from a per shard counter and takes no locks.
+
+    Element lifetime is the responsibility of the client. A pointer returned by @c find is valid
+    only while the client ensures no other thread erases and destroys that element. Lookups with
+    a function run the function while the shard is locked, which avoids that issue.
+
+    For iteration, or any other operation on a shard as a whole, @c read_shard and @c write_shard
+    provide access to a shard @c IntrusiveHashMap while holding the appropriate lock.
+
+    @code
+    ShardedIntrusiveHashMap<Descriptor, 16> table;
+    table.insert(session);
+    table.find(key, [&](Session& s) { s.touch(); });
+    for (size_t idx = 0 ; idx < table.SHARD_COUNT ; ++idx) {
+      auto shard = table.read_shard(idx);
+      for (auto& s : *shard) { ... }
+    }
+    @endcode
+ */
+template<typename H, size_t N> class ShardedIntrusiveHashMap {
+  using self_type = ShardedIntrusiveHashMap; ///< Self reference type.
+  static_assert(N > 0, "ShardedIntrusiveHashMap must have at least one shard.");
+
+public:
+  /// Map type for each shard.
+  using map_type   = IntrusiveHashMap<H>;
+  using value_type = typename map_type::value_type;
+  using key_type   = typename map_type::key_type;
+  using hash_id    = typename map_type::hash_id;
+
+  /// Number of shards.
+  static constexpr size_t SHARD_COUNT = N;
+
+protected:
+  /// A shard of the map, aligned to keep the locks of different shards in different cache lines.
+  struct alignas(64) Shard {
+    mutable std::shared_mutex _mutex; ///< Lock for @a _map.
+    map_type _map;                    ///< Elements in this shard.
+    std::atomic<size_t> _count{0};    ///< Element count, updated while @a _mutex is exclusively held.
+  };
+
+  /** Locked access to a shard.
+
+      @tparam LOCK The lock type.
+      @tparam MAP The map type, @c const for shared access.
+
+      The shard is locked as long as this object exists.
+   */
+  template<typename LOCK, typename MAP> class ShardLock {
+    using self_type = ShardLock; ///< Self reference type.
+    friend class ShardedIntrusiveHashMap;
+
+  public:
+    ShardLock(self_type&& that) = default;
+    ~ShardLock();
+
+    MAP& operator*() const;
+    MAP *operator->() const;
+
+  protected:
+    explicit ShardLock(Shard& shard);
+
+    LOCK _lock;    ///< Lock on the shard mutex.
+    Shard *_shard; ///< Locked shard.
+  };
+
+public:
+  /// Shared access to a shard.
+  using ShardReader = ShardLock<std::shared_lock<std::shared_mutex>, map_type const>;
+  /// Exclusive access to a shard.
+  using ShardWriter = ShardLock<std::unique_lock<std::shared_mutex>, map_type>;
+
+  ShardedIntrusiveHashMap() = default;
+
+  // noncopyable
+  ShardedIntrusiveHashMap(self_type const&) = delete;
+  self_type& operator=(self_type const&) = delete;
+
+  /** Insert @a v in to the map.
+
+      The @a value must @b NOT already be in a table of this type.
+   */
+  void insert(value_type *v);
+
+  /** Find an element with a key equal to @a key.
+
+      @return The element, or @c nullptr if not found.
+   */
+  value_type *find(key_type key) const;
+
+  /** Find an element with a key equal to @a key and apply @a f to it.
+
+      @tparam F A functional object of the form <tt>void F(value_type&)</tt>.
+      @return @c true if an element was found.
+
+      The shard for @a key is locked while @a f is invoked, therefore @a f must not access this map.
+   */
+  template<typename F> bool find(key_type key, F&& f) const;
+
+  /// @return @c true if there is an element with a key equal to @a key.
+  bool contains(key_type key) const;
+
+  /// Remove @a value from the map.
+  /// @return @c true if @a value was in the map and removed, @c false if it was not in the map.
+  bool erase(value_type *value);
+
+  /// Remove all values from the map.
+  /// The values are not cleaned up, as for @c IntrusiveHashMap::clear.
+  self_type& clear();
+
+  /** Number of elements in the map.
+
+      This does not lock any shard, so concurrent updates may or may not be counted.
+   */
+  size_t count() const;
+
+  /// Index of the shard for elements with key @a key.
+  static size_t shard_for(key_type key);
+
+  /// Number of elements in shard @a idx.
+  size_t shard_count(size_t idx) const;
+
+  /// Access shard @a idx with a shared lock.
+  ShardReader read_shard(size_t idx) const;
+
+  /// Access shard @a idx with an exclusive lock.
+  ShardWriter write_shard(size_t idx);
+
+  /** Apply @a f to every element in the map, one shard at a time.
+
+      @tparam F A functional object of the form <tt>void F(value_type&)</tt> or <tt>void F(value_type*)</tt>.
+
+      Each shard is exclusively locked while @a f is applied to the elements in that shard. As for
+      @c IntrusiveHashMap::apply, @a f can destroy the element.
+   */
+  template<typename F> self_type& apply(F&& f);
+
+protected:
+  std::array<Shard, N> _shards; ///< Shards.
+
+  /// The shard for @a key.
+  Shard& shard_of(key_type key) const;
+};
+
+template<typename H, size_t N>
+template<typename LOCK, typename MAP>
+ShardedIntrusiveHashMap<H, N>::ShardLock<LOCK, MAP>::ShardLock(Shard& shard) : _lock(shard._mutex), _shard(&shard) {}
+
+template<typename H, size_t N>
+template<typename LOCK, typename MAP>
+ShardedIntrusiveHashMap<H, N>::ShardLock<LOCK, MAP>::~ShardLock() {
+  // The map may have been changed, update the count while the lock is still held.
+  if constexpr (!std::is_const_v<MAP>) {
+    if (_lock.owns_lock()) {
+      _shard->_count.store(_shard->_map.count(), std::memory_order_relaxed);
+    }
+  }
+}
+
+template<typename H, size_t N>
+template<typename LOCK, typename MAP>
+auto
+ShardedIntrusiveHashMap<H, N>::ShardLock<LOCK, MAP>::operator*() const -> MAP& {
+  return _shard->_map;
+}
+
+template<typename H, size_t N>
+template<typename LOCK, typename MAP>
+auto
+ShardedIntrusiveHashMap<H, N>::ShardLock<LOCK, MAP>::operator->() const -> MAP * {
+  return &_shard->_map;
+}
+
+// Use the high bits of the hash, after spreading it with a multiplication, to select the shard.
+// Buckets in a shard are selected from the low bits, which would otherwise be correlated with the shard.
+template<typename H, size_t N>
+size_t
+ShardedIntrusiveHashMap<H, N>::shard_for(key_type key) {
+  uint64_t h = static_cast<uint64_t>(H::hash_of(key)) * 0x9E3779B97F4A7C15ULL;
+  return bucket_sizing::FastRange::index(h, N);
+}
+
+template<typename H, size_t N>
+auto
+ShardedIntrusiveHashMap<H, N>::shard_of(key_type key) const -> Shard& {
+  return const_cast<Shard&>(_shards[shard_for(key)]);
+}
+
+template<typename H, size_t N>
+void
+ShardedIntrusiveHashMap<H, N>::insert(value_type *v) {
+  Shard& shard = this->shard_of(H::key_of(v));
+  std::unique_lock lock(shard._mutex);
+  shard._map.insert(v);
+  shard._count.store(shard._map.count(), std::memory_order_relaxed);
+}
+
+// IntrusiveHashMap lookups do not modify the map, so a shared lock is sufficient even though the
+// non-const find is used to get a non-const element.
+template<typename H, size_t N>
+auto
+ShardedIntrusiveHashMap<H, N>::find(key_type key) const -> value_type * {
+  Shard& shard = this->shard_of(key);
+  std::shared_lock lock(shard._mutex);
+  auto spot = shard._map.find(key);
+  return spot == shard._map.end() ? nullptr : &*spot;
+}
+
+template<typename H, size_t N>
+template<typename F>
+bool
+ShardedIntrusiveHashMap<H, N>::find(key_type key, F&& f) const {
+  Shard& shard = this->shard_of(key);
+  std::shared_lock lock(shard._mutex);
+  if (auto spot = shard._map.find(key); spot != shard._map.end()) {
+    f(*spot);
+    return true;
+  }
+  return false;
+}
+
+template<typename H, size_t N>
+bool
+ShardedIntrusiveHashMap<H, N>::contains(key_type key) const {
+  Shard& shard = this->shard_of(key);
+  std::shared_lock lock(shard._mutex);
+  return shard._map.find(key) != shard._map.end();
+}
+
+template<typename H, size_t N>
+bool
+ShardedIntrusiveHashMap<H, N>::erase(value_type *value) {
+  Shard& shard = this->shard_of(H::key_of(value));
+  std::unique_lock lock(shard._mutex);
+  if (shard._map.erase(value)) {
+    shard._count.store(shard._map.count(), std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+template<typename H, size_t N>
+auto
+ShardedIntrusiveHashMap<H, N>::clear() -> self_type& {
+  for (auto& shard : _shards) {
+    std::unique_lock lock(shard._mutex);
+    shard._map.clear();
+    shard._count.store(0, std::memory_order_relaxed);
+  }
+  return *this;
+}
+
+template<typename H, size_t N>
+size_t
+ShardedIntrusiveHashMap<H, N>::count() const {
+  size_t zret = 0;
+  for (auto const& shard : _shards) {
+    zret += shard._count.load(std::memory_order_relaxed);
+  }
+  return zret;
+}
+
+template<typename H, size_t N>
+size_t
+ShardedIntrusiveHashMap<H, N>::shard_count(size_t idx) const {
+  return _shards[idx]._count.load(std::memory_order_relaxed);
+}
+
+template<typename H, size_t N>
+auto
+ShardedIntrusiveHashMap<H, N>::read_shard(size_t idx) const -> ShardReader {
+  return ShardReader{const_cast<Shard&>(_shards[idx])};
+}
+
+template<typename H, size_t N>
+auto
+ShardedIntrusiveHashMap<H, N>::write_shard(size_t idx) -> ShardWriter {
+  return ShardWriter{_shards[idx]};
+}
+
+template<typename H, size_t N>
+template<typename F>
+auto
+ShardedIntrusiveHashMap<H, N>::apply(F&& f) -> self_type& {
+  for (size_t idx = 0; idx < N; ++idx) {
+    this->write_shard(idx)->apply(f);
+  }
+  return *this;
+}
+
+}} // namespace swoc
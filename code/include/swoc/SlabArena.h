@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+   Multiple size class allocator on top of a @c MemArena.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "swoc/swoc_version.h"
+#include "swoc/MemArena.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+/** Allocator for objects of many sizes, on top of a @c MemArena.
+ *
+ * This is a generalization of @c FixedArena for multiple sizes. Sizes are rounded up to a size
+ * class and each size class has a free list of released memory, so that memory can be reused by
+ * any object of the same size class. Allocation and deallocation are constant time.
+ *
+ * The size classes are multiples of 16 up to 64, and then four classes for every power of two, e.g.
+ * 80, 96, 112, 128, 160, 192, ... The largest size class is @c MAX_SIZE. Larger sizes are allocated
+ * directly from the arena and are not reused.
+ *
+ * Memory is aligned as for @c std::max_align_t.
+ *
+ * This is not thread safe. To use in multiple threads, each thread should have its own instance,
+ * e.g. on the thread's arena in a @c ConcurrentMemArena. Memory must be deallocated to the same
+ * instance that allocated it.
+ *
+ * @code
+ *   MemArena arena;
+ *   SlabArena slab{arena};
+ *   auto node = slab.make<Node>(args...);
+ *   auto item = slab.make<Item>(args...);
+ *   slab.destroy(node); // memory is reused for other objects of the same size class.
+ * @endcode
+ */
+class SlabArena {
+  using self_type = SlabArena; ///< Self reference type.
+
+public:
+  /// Minimum size class and the granularity of the small size classes.
+  static constexpr size_t QUANTUM = alignof(std::max_align_t);
+  /// Largest size class.
+  static constexpr size_t MAX_SIZE = 4096;
+
+  /** Construct on @a arena.
+   *
+   * @param arena Source of memory. This must outlive @a this.
+   */
+  explicit SlabArena(MemArena& arena);
+
+  /// No copying.
+  SlabArena(self_type const&) = delete;
+  /// No copy assignment.
+  self_type& operator=(self_type const&) = delete;
+
+  /** Allocate memory.
+   *
+   * @param n Number of bytes.
+   * @return Memory for at least @a n bytes.
+   */
+  void *allocate(size_t n);
+
+  /** Deallocate memory.
+   *
+   * @param ptr Memory from @c allocate.
+   * @param n The size passed to @c allocate.
+   */
+  void deallocate(void *ptr, size_t n);
+
+  /** Create an instance of @a T.
+   *
+   * @tparam T Type of instance.
+   * @param args Constructor arguments.
+   * @return A new instance of @a T.
+   */
+  template <typename T, typename... Args> T *make(Args&&... args);
+
+  /** Destroy an instance of @a T.
+   *
+   * @param t Instance from @c make.
+   *
+   * The instance is destructed and its memory put on the free list for its size class.
+   */
+  template <typename T> void destroy(T *t);
+
+  /** Drop all free lists.
+   *
+   * @return @a this
+   *
+   * This must be done if the arena is cleared.
+   */
+  self_type& clear();
+
+  /// @return The arena used by @a this.
+  MemArena& arena() const;
+
+  /** The size class for @a n bytes.
+   *
+   * @param n Number of bytes.
+   * @return The size of memory allocated for @a n bytes.
+   */
+  static constexpr size_t class_size(size_t n);
+
+  /** The index of the size class for @a n bytes.
+   *
+   * @param n Number of bytes, which must be in the range [1, MAX_SIZE].
+   * @return The index of the size class.
+   */
+  static constexpr unsigned class_index(size_t n);
+
+protected:
+  /// Free list item, overlaid on released memory.
+  struct Item {
+    Item *_next; ///< Next free item.
+  };
+
+  /// Size of the largest class with the minimum granularity.
+  static constexpr size_t SMALL_SIZE = QUANTUM * 4;
+  /// Number of size classes.
+  static constexpr unsigned N_CLASSES = 28;
+
+  /// @return Position of the most significant bit of @a n, plus one.
+  static constexpr unsigned bit_width(size_t n);
+
+  MemArena& _arena;                    ///< Memory source.
+  std::array<Item *, N_CLASSES> _free{}; ///< Free lists.
+};
+
+// --- Implementation
+
+inline SlabArena::SlabArena(MemArena& arena) : _arena(arena) {}
+
+inline MemArena&
+SlabArena::arena() const {
+  return _arena;
+}
+
+constexpr unsigned
+SlabArena::bit_width(size_t n) {
+  unsigned zret = 0;
+  while (n) {
+    ++zret;
+    n >>= 1;
+  }
+  return zret;
+}
+
+constexpr unsigned
+SlabArena::class_index(size_t n) {
+  if (n <= SMALL_SIZE) {
+    return n <= QUANTUM ? 0 : (n - 1) / QUANTUM;
+  }
+  // For n in (2^(b-1), 2^b] there are 4 classes, 2^(b-1) + k * 2^(b-3) for k in [1, 4].
+  unsigned b = bit_width(n - 1);
+  unsigned k = ((n - 1) >> (b - 3)) - 3;
+  return 4 * (b - bit_width(SMALL_SIZE)) + k + 3;
+}
+
+constexpr size_t
+SlabArena::class_size(size_t n) {
+  if (n <= SMALL_SIZE) {
+    return n <= QUANTUM ? QUANTUM : (n + QUANTUM - 1) & ~(QUANTUM - 1);
+  }
+  if (n > MAX_SIZE) {
+    return n;
+  }
+  unsigned b = bit_width(n - 1);
+  size_t k   = ((n - 1) >> (b - 3)) - 3;
+  return (size_t(1) << (b - 1)) + (k << (b - 3));
+}
+
+inline void *
+SlabArena::allocate(size_t n) {
+  static_assert(class_index(MAX_SIZE) + 1 == N_CLASSES);
+  static_assert(class_size(MAX_SIZE) == MAX_SIZE);
+  if (n > MAX_SIZE) {
+    return _arena.alloc(n, QUANTUM).data();
+  }
+  auto idx = class_index(n);
+  if (Item *item = _free[idx]; item) {
+    _free[idx] = item->_next;
+    return item;
+  }
+  return _arena.alloc(class_size(n), QUANTUM).data();
+}
+
+inline void
+SlabArena::deallocate(void *ptr, size_t n) {
+  if (ptr && n <= MAX_SIZE) {
+    auto idx   = class_index(n);
+    _free[idx] = new (ptr) Item{_free[idx]};
+  }
+}
+
+template <typename T, typename... Args>
+T *
+SlabArena::make(Args&&... args) {
+  static_assert(alignof(T) <= QUANTUM, "SlabArena does not support over aligned types.");
+  return new (this->allocate(sizeof(T))) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void
+SlabArena::destroy(T *t) {
+  if (t) {
+    t->~T();
+    this->deallocate(t, sizeof(T));
+  }
+}
+
+inline auto
+SlabArena::clear() -> self_type& {
+  _free.fill(nullptr);
+  return *this;
+}
+
+}} // namespace swoc
@@ -38,6 +38,8 @@ class IP6Net;
 
 class IPNet;
 
+template <typename PAYLOAD> class IPSpaceView;
+
 using ::std::string_view;
 extern void * const pseudo_nullptr ;
 
@@ -478,6 +480,12 @@ public:
     return *this;
   }
 
+  /// @return The most significant 64 bits of the address, in host order.
+  word_type msw() const { return _addr._store[MSW]; }
+
+  /// @return The least significant 64 bits of the address, in host order.
+  word_type lsw() const { return _addr._store[LSW]; }
+
   self_type& operator&=(IPMask const& mask);
 
   self_type& operator|=(IPMask const& mask);
@@ -1405,6 +1413,7 @@ protected:
 /** Coloring of IP address space.
  *
  * @tparam PAYLOAD The color class.
+ * @tparam EQUAL Payload equality policy.
  *
  * This is a class to do fast coloring and lookup of the IP address space. It is range oriented and
  * performs well for ranges, much less well for singletons. Conceptually every IP address is a key
@@ -1413,12 +1422,14 @@ protected:
  * @c PAYLOAD must have the properties
  *
  * - Cheap to copy.
- * - Comparable via the equality and inequality operators.
+ * - Comparable via @c EQUAL, which by default uses the equality operator.
+ *
+ * @see DiscreteSpace for the requirements on @c EQUAL.
  */
-template<typename PAYLOAD> class IPSpace {
+template<typename PAYLOAD, typename EQUAL = std::equal_to<PAYLOAD>> class IPSpace {
   using self_type = IPSpace;
-  using IP4Space  = DiscreteSpace<IP4Addr, PAYLOAD>;
-  using IP6Space  = DiscreteSpace<IP6Addr, PAYLOAD>;
+  using IP4Space  = DiscreteSpace<IP4Addr, PAYLOAD, EQUAL>;
+  using IP6Space  = DiscreteSpace<IP6Addr, PAYLOAD, EQUAL>;
 
 public:
   using payload_t = PAYLOAD; ///< Export payload type.
@@ -1488,6 +1499,102 @@ public:
     return *this;
   }
 
+  /** Merge @a that in to @a this.
+   *
+   * @tparam F Combining functor type (deduced).
+   * @param that Other space.
+   * @param combiner Combining functor.
+   * @return @a this
+   *
+   * Every address in either space is in the result. For addresses in both spaces the payloads are
+   * combined by @a combiner which has the same signature and semantics as the blender for
+   * @c blend, with the payload from @a that as the color. This is linear in the number of ranges.
+   *
+   * @see DiscreteSpace::merge
+   */
+  template <typename F> self_type& merge(self_type const& that, F&& combiner) {
+    _ip4.merge(that._ip4, combiner);
+    _ip6.merge(that._ip6, combiner);
+    return *this;
+  }
+
+  /** Merge @a that in to @a this.
+   *
+   * @param that Other space.
+   * @return @a this
+   *
+   * For addresses in both spaces, the payload in @a that is used.
+   */
+  self_type& merge(self_type const& that) {
+    _ip4.merge(that._ip4);
+    _ip6.merge(that._ip6);
+    return *this;
+  }
+
+  /** Intersect @a this with @a that.
+   *
+   * @tparam F Combining functor type (deduced).
+   * @param that Other space.
+   * @param combiner Combining functor.
+   * @return @a this
+   *
+   * Only addresses in both spaces are kept, with payloads combined as for @c merge.
+   */
+  template <typename F> self_type& intersect(self_type const& that, F&& combiner) {
+    _ip4.intersect(that._ip4, combiner);
+    _ip6.intersect(that._ip6, combiner);
+    return *this;
+  }
+
+  /** Intersect @a this with @a that.
+   *
+   * @param that Other space.
+   * @return @a this
+   *
+   * Only addresses in both spaces are kept, with the payloads in @a this.
+   */
+  self_type& intersect(self_type const& that) {
+    _ip4.intersect(that._ip4);
+    _ip6.intersect(that._ip6);
+    return *this;
+  }
+
+  /** Subtract @a that from @a this.
+   *
+   * @param that Other space.
+   * @return @a this
+   *
+   * Addresses in @a that are removed from @a this.
+   */
+  self_type& subtract(self_type const& that) {
+    _ip4.subtract(that._ip4);
+    _ip6.subtract(that._ip6);
+    return *this;
+  }
+
+  /** Compute the differences between two spaces.
+   *
+   * @tparam F Delta functor type (deduced).
+   * @param prev Previous space.
+   * @param next Updated space.
+   * @param f Delta functor.
+   *
+   * @a f is called with the signature <tt>void (IPRange const& range, PAYLOAD const* prev_payload,
+   * PAYLOAD const* next_payload)</tt> for every range where @a prev and @a next differ, IPv4 ranges
+   * first and each family in ascending order. A payload pointer is @c nullptr if the range is not
+   * in that space. This is linear in the number of ranges in both spaces.
+   *
+   * @see DiscreteSpace::diff
+   */
+  template <typename F> static void diff(self_type const& prev, self_type const& next, F&& f) {
+    IP4Space::diff(prev._ip4, next._ip4, [&](DiscreteRange<IP4Addr> const& range, PAYLOAD const* lhs, PAYLOAD const* rhs) {
+      f(IPRange{IP4Range{range.min(), range.max()}}, lhs, rhs);
+    });
+    IP6Space::diff(prev._ip6, next._ip6, [&](DiscreteRange<IP6Addr> const& range, PAYLOAD const* lhs, PAYLOAD const* rhs) {
+      f(IPRange{IP6Range{range.min(), range.max()}}, lhs, rhs);
+    });
+  }
+
   /// @return The number of distinct ranges.
   size_t count() const { return _ip4.count() + _ip6.count(); }
 
@@ -1499,6 +1606,84 @@ public:
   /// Remove all ranges.
   void clear();
 
+  /** Merge adjacent ranges with equal payloads.
+   *
+   * @return @a this
+   *
+   * @see DiscreteSpace::compact
+   */
+  self_type& compact() {
+    _ip4.compact();
+    _ip6.compact();
+    return *this;
+  }
+
+  /** Create a frozen, flat copy of the space for fast lookup.
+   *
+   * @return An immutable view of the current contents of @a this.
+   *
+   * The view is independent of @a this, later changes to the space are not reflected in the view.
+   *
+   * @note This requires "swoc/IPSpaceView.h".
+   */
+  IPSpaceView<PAYLOAD> freeze() const;
+
+  /** Bulk loader.
+   *
+   * Ranges are accumulated and then put in the space at once, which is much faster than
+   * calling @c mark for each range. The result is the same as marking the ranges in the order
+   * they were added, after the current contents of the space.
+   *
+   * @see DiscreteSpace::Loader
+   */
+  class Loader {
+    using self_type = Loader; ///< Self reference type.
+  public:
+    /** Construct a loader for @a space.
+     *
+     * @param space Target space.
+     */
+    explicit Loader(IPSpace& space) : _space(space), _ip4(space._ip4), _ip6(space._ip6) {}
+
+    /** Add a range to load.
+     *
+     * @param range Range to mark.
+     * @param payload Payload for @a range.
+     * @return @a this
+     */
+    self_type& mark(IPRange const& range, PAYLOAD const& payload);
+
+    /// Add an IPv4 @a range with @a payload.
+    self_type& mark(IP4Range const& range, PAYLOAD const& payload) {
+      _ip4.mark(range, payload);
+      return *this;
+    }
+
+    /// Add an IPv6 @a range with @a payload.
+    self_type& mark(IP6Range const& range, PAYLOAD const& payload) {
+      _ip6.mark(range, payload);
+      return *this;
+    }
+
+    /// @return The number of ranges added.
+    size_t count() const { return _ip4.count() + _ip6.count(); }
+
+    /** Load the ranges in to the space.
+     *
+     * @return The space.
+     */
+    IPSpace& load() {
+      _ip4.load();
+      _ip6.load();
+      return _space;
+    }
+
+  protected:
+    IPSpace& _space; ///< Target space.
+    typename IP4Space::Loader _ip4; ///< IPv4 loader.
+    typename IP6Space::Loader _ip6; ///< IPv6 loader.
+  };
+
   /** Constant iterator.
    * THe value type is a tuple of the IP address range and the @a PAYLOAD. Both are constant.
    *
@@ -1687,6 +1872,37 @@ public:
     return {_ip4.end(), _ip6.find(addr)};
   }
 
+  /** Find the payload for an @a addr.
+   *
+   * @param addr Address to find.
+   * @return Constant iterator for the range containing @a addr.
+   */
+  const_iterator find(IPAddr const& addr) const { return const_cast<self_type *>(this)->find(addr); }
+
+  /// @copydoc find(IPAddr const&) const
+  const_iterator find(IP4Addr const& addr) const { return const_cast<self_type *>(this)->find(addr); }
+
+  /// @copydoc find(IPAddr const&) const
+  const_iterator find(IP6Addr const& addr) const { return const_cast<self_type *>(this)->find(addr); }
+
+  /** Find the payloads for a batch of addresses.
+   *
+   * @param addrs Addresses to find.
+   * @param results Iterators for the ranges containing the corresponding address in @a addrs.
+   *
+   * @a results must be at least as large as @a addrs. The result for an address that is not in
+   * the space is @c end(). This is equivalent to calling @c find on each address but hides most
+   * of the memory latency of the tree searches by doing them in lock step.
+   *
+   * @see DiscreteSpace::find_batch
+   */
+  void find_batch(MemSpan<IPAddr const> addrs, MemSpan<iterator> results) { this->find_batch_impl(addrs, results); }
+
+  /// @copydoc find_batch(MemSpan<IPAddr const>, MemSpan<iterator>)
+  void find_batch(MemSpan<IPAddr const> addrs, MemSpan<const_iterator> results) const {
+    const_cast<self_type *>(this)->find_batch_impl(addrs, results);
+  }
+
   /// @return A constant iterator to the first element.
   const_iterator begin() const;
 
@@ -1726,10 +1942,13 @@ public:
 protected:
   IP4Space _ip4; ///< Sub-space containing IPv4 ranges.
   IP6Space _ip6; ///< sub-space containing IPv6 ranges.
+
+  /// Batch find, for either iterator type.
+  template <typename ITER> void find_batch_impl(MemSpan<IPAddr const> addrs, MemSpan<ITER> results);
 };
 
-template<typename PAYLOAD>
-IPSpace<PAYLOAD>::const_iterator::const_iterator(typename IP4Space::iterator const& iter4
+template<typename PAYLOAD, typename EQUAL>
+IPSpace<PAYLOAD, EQUAL>::const_iterator::const_iterator(typename IP4Space::iterator const& iter4
                                                  , typename IP6Space::iterator const& iter6)
     : _iter_4(iter4), _iter_6(iter6) {
   if (_iter_4.has_next()) {
@@ -1739,21 +1958,21 @@ IPSpace<PAYLOAD>::const_iterator::const_iterator(typename IP4Space::iterator con
   }
 }
 
-template<typename PAYLOAD>
-IPSpace<PAYLOAD>::const_iterator::const_iterator(self_type const& that) {
+template<typename PAYLOAD, typename EQUAL>
+IPSpace<PAYLOAD, EQUAL>::const_iterator::const_iterator(self_type const& that) {
   *this = that;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::const_iterator::operator=(self_type const& that) -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::const_iterator::operator=(self_type const& that) -> self_type& {
   _iter_4 = that._iter_4;
   _iter_6 = that._iter_6;
   new(&_value) value_type{that._value};
   return *this;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::const_iterator::operator++() -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::const_iterator::operator++() -> self_type& {
   bool incr_p = false;
   if (_iter_4.has_next()) {
     ++_iter_4;
@@ -1774,15 +1993,15 @@ auto IPSpace<PAYLOAD>::const_iterator::operator++() -> self_type& {
   return *this;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::const_iterator::operator++(int) -> self_type {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::const_iterator::operator++(int) -> self_type {
   self_type zret(*this);
   ++*this;
   return zret;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::const_iterator::operator--() -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::const_iterator::operator--() -> self_type& {
   if (_iter_6.has_prev()) {
     --_iter_6;
     new(&_value) value_type{_iter_6->range(), _iter_6->payload()};
@@ -1797,18 +2016,18 @@ auto IPSpace<PAYLOAD>::const_iterator::operator--() -> self_type& {
   return *this;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::const_iterator::operator--(int) -> self_type {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::const_iterator::operator--(int) -> self_type {
   self_type zret(*this);
   --*this;
   return zret;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::const_iterator::operator*() const -> value_type const& { return _value; }
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::const_iterator::operator*() const -> value_type const& { return _value; }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::const_iterator::operator->() const -> value_type const * { return &_value; }
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::const_iterator::operator->() const -> value_type const * { return &_value; }
 
 /* Bit of subtlety with equality - although it seems that if @a _iter_4 is valid, it doesn't matter
  * where @a _iter6 is (because it is really the iterator location that's being checked), it's
@@ -1818,47 +2037,47 @@ auto IPSpace<PAYLOAD>::const_iterator::operator->() const -> value_type const *
  * active iterator therefore it's effective and cheaper to just check both values.
  */
 
-template<typename PAYLOAD>
+template<typename PAYLOAD, typename EQUAL>
 bool
-IPSpace<PAYLOAD>::const_iterator::operator==(self_type const& that) const {
+IPSpace<PAYLOAD, EQUAL>::const_iterator::operator==(self_type const& that) const {
   return _iter_4 == that._iter_4 && _iter_6 == that._iter_6;
 }
 
-template<typename PAYLOAD>
+template<typename PAYLOAD, typename EQUAL>
 bool
-IPSpace<PAYLOAD>::const_iterator::operator!=(self_type const& that) const {
+IPSpace<PAYLOAD, EQUAL>::const_iterator::operator!=(self_type const& that) const {
   return _iter_4 != that._iter_4 || _iter_6 != that._iter_6;
 }
 
-template<typename PAYLOAD>
-IPSpace<PAYLOAD>::iterator::iterator(self_type const& that) {
+template<typename PAYLOAD, typename EQUAL>
+IPSpace<PAYLOAD, EQUAL>::iterator::iterator(self_type const& that) {
   *this = that;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::iterator::operator=(self_type const& that) -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::iterator::operator=(self_type const& that) -> self_type& {
   this->super_type::operator=(that);
   return *this;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::iterator::operator->() const -> value_type const * {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::iterator::operator->() const -> value_type const * {
   return static_cast<value_type *>(&super_type::_value);
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::iterator::operator*() const -> value_type const& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::iterator::operator*() const -> value_type const& {
   return reinterpret_cast<value_type const&>(super_type::_value);
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::iterator::operator++() -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::iterator::operator++() -> self_type& {
   this->super_type::operator++();
   return *this;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::iterator::operator--() -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::iterator::operator--() -> self_type& {
   this->super_type::operator--();
   return *this;
 }
@@ -2728,8 +2947,61 @@ inline bool IPRange::NetSource::operator!=(self_type const& that) const {
 
 // --- IPSpace
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::mark(IPRange const& range, PAYLOAD const& payload) -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::mark(IPRange const& range, PAYLOAD const& payload) -> self_type& {
+  if (range.is(AF_INET)) {
+    _ip4.mark(range.ip4(), payload);
+  } else if (range.is(AF_INET6)) {
+    _ip6.mark(range.ip6(), payload);
+  }
+  return *this;
+}
+
+template <typename PAYLOAD, typename EQUAL>
+template <typename ITER>
+void
+IPSpace<PAYLOAD, EQUAL>::find_batch_impl(MemSpan<IPAddr const> addrs, MemSpan<ITER> results) {
+  static constexpr size_t N = IP4Space::BATCH_GROUP;
+  // Split each group by family and search each family as a batch.
+  IP4Addr keys4[N];
+  IP6Addr keys6[N];
+  typename IP4Space::iterator found4[N];
+  typename IP6Space::iterator found6[N];
+  size_t idx4[N];
+  size_t idx6[N];
+  for (size_t base = 0; base < addrs.count(); base += N) {
+    auto n    = std::min(N, addrs.count() - base);
+    size_t n4 = 0;
+    size_t n6 = 0;
+    for (size_t idx = base; idx < base + n; ++idx) {
+      auto const& addr = addrs[idx];
+      if (addr.is_ip4()) {
+        keys4[n4] = addr.ip4();
+        idx4[n4++] = idx;
+      } else if (addr.is_ip6()) {
+        keys6[n6] = addr.ip6();
+        idx6[n6++] = idx;
+      } else {
+        results[idx] = this->end();
+      }
+    }
+    if (n4) {
+      _ip4.find_batch(MemSpan<IP4Addr const>{keys4, n4}, MemSpan<typename IP4Space::iterator>{found4, n4});
+      for (size_t k = 0; k < n4; ++k) {
+        results[idx4[k]] = found4[k] == _ip4.end() ? this->end() : iterator{found4[k], _ip6.begin()};
+      }
+    }
+    if (n6) {
+      _ip6.find_batch(MemSpan<IP6Addr const>{keys6, n6}, MemSpan<typename IP6Space::iterator>{found6, n6});
+      for (size_t k = 0; k < n6; ++k) {
+        results[idx6[k]] = iterator{_ip4.end(), found6[k]};
+      }
+    }
+  }
+}
+
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::Loader::mark(IPRange const& range, PAYLOAD const& payload) -> self_type& {
   if (range.is(AF_INET)) {
     _ip4.mark(range.ip4(), payload);
   } else if (range.is(AF_INET6)) {
@@ -2738,8 +3010,8 @@ auto IPSpace<PAYLOAD>::mark(IPRange const& range, PAYLOAD const& payload) -> sel
   return *this;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::fill(IPRange const& range, PAYLOAD const& payload) -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::fill(IPRange const& range, PAYLOAD const& payload) -> self_type& {
   if (range.is(AF_INET6)) {
     _ip6.fill(range.ip6(), payload);
   } else if (range.is(AF_INET)) {
@@ -2748,8 +3020,8 @@ auto IPSpace<PAYLOAD>::fill(IPRange const& range, PAYLOAD const& payload) -> sel
   return *this;
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::erase(IPRange const& range) -> self_type& {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::erase(IPRange const& range) -> self_type& {
   if (range.is(AF_INET)) {
     _ip4.erase(range.ip4());
   } else if (range.is(AF_INET6)) {
@@ -2758,9 +3030,9 @@ auto IPSpace<PAYLOAD>::erase(IPRange const& range) -> self_type& {
   return *this;
 }
 
-template<typename PAYLOAD>
+template<typename PAYLOAD, typename EQUAL>
 template<typename F, typename U>
-auto IPSpace<PAYLOAD>::blend(IPRange const& range, U const& color, F&& blender) -> self_type& {
+auto IPSpace<PAYLOAD, EQUAL>::blend(IPRange const& range, U const& color, F&& blender) -> self_type& {
   if (range.is(AF_INET)) {
     _ip4.blend(range.ip4(), color, blender);
   } else if (range.is(AF_INET6)) {
@@ -2769,54 +3041,54 @@ auto IPSpace<PAYLOAD>::blend(IPRange const& range, U const& color, F&& blender)
   return *this;
 }
 
-template<typename PAYLOAD>
-void IPSpace<PAYLOAD>::clear() {
+template<typename PAYLOAD, typename EQUAL>
+void IPSpace<PAYLOAD, EQUAL>::clear() {
   _ip4.clear();
   _ip6.clear();
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::begin() const -> const_iterator {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::begin() const -> const_iterator {
   auto nc_this = const_cast<self_type *>(this);
   return const_iterator(nc_this->_ip4.begin(), nc_this->_ip6.begin());
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::end() const -> const_iterator {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::end() const -> const_iterator {
   auto nc_this = const_cast<self_type *>(this);
   return const_iterator(nc_this->_ip4.end(), nc_this->_ip6.end());
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::begin_ip4() const -> const_iterator {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::begin_ip4() const -> const_iterator {
   return this->begin();
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::end_ip4() const -> const_iterator {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::end_ip4() const -> const_iterator {
   auto nc_this = const_cast<self_type *>(this);
   return iterator(nc_this->_ip4.end(), nc_this->_ip6.begin());
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::begin_ip6() const -> const_iterator {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::begin_ip6() const -> const_iterator {
   auto nc_this = const_cast<self_type *>(this);
   return iterator(nc_this->_ip4.end(), nc_this->_ip6.begin());
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::end_ip6() const -> const_iterator {
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::end_ip6() const -> const_iterator {
   return this->end();
 }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::begin() -> iterator { return iterator{_ip4.begin(), _ip6.begin()}; }
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::begin() -> iterator { return iterator{_ip4.begin(), _ip6.begin()}; }
 
-template<typename PAYLOAD>
-auto IPSpace<PAYLOAD>::end() -> iterator { return iterator{_ip4.end(), _ip6.end()}; }
+template<typename PAYLOAD, typename EQUAL>
+auto IPSpace<PAYLOAD, EQUAL>::end() -> iterator { return iterator{_ip4.end(), _ip6.end()}; }
 
-template<typename PAYLOAD>
-size_t IPSpace<PAYLOAD>::count(sa_family_t f) const {
+template<typename PAYLOAD, typename EQUAL>
+size_t IPSpace<PAYLOAD, EQUAL>::count(sa_family_t f) const {
   return IP4Addr::AF_value == f ? _ip4.count()
                                 : IP6Addr::AF_value == f ? _ip6.count()
                                                          : 0;
@@ -4,6 +4,7 @@
  * @c BufferWriter for a @c MemArena.
  */
 
+#include <algorithm>
 #include "swoc/ArenaWriter.h"
 
 namespace swoc { inline namespace SWOC_VERSION_NS {
@@ -41,8 +42,10 @@ ArenaWriter::commit(size_t n)
 void
 ArenaWriter::realloc(size_t n)
 {
-  auto text                    = this->view(); // Current data.
-  auto span                    = _arena.require(n).remnant().rebind<char>();
+  auto text = this->view(); // Current data.
+  // Grow geometrically so that the total amount of copying is linear in the final size.
+  n         = std::max(n, 2 * _capacity);
+  auto span = _arena.require(n).remnant().rebind<char>();
   const_cast<char *&>(_buffer) = span.data();
   _capacity                    = span.size();
   memcpy(_buffer, text.data(), text.size());
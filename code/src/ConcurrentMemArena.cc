@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright Verizon Media 2020
+/** @file
+
+    Memory arena shared between threads.
+ */
+#include <algorithm>
+#include "swoc/ConcurrentMemArena.h"
+
+namespace swoc { inline namespace SWOC_VERSION_NS {
+
+MemArena&
+ConcurrentMemArena::attach() {
+  auto tid = std::this_thread::get_id();
+  Slot *slot{nullptr};
+  {
+    std::lock_guard lock{_mutex};
+    // The thread may already have a slot if its cache entry was taken by another arena.
+    auto spot = std::find_if(_slots.begin(), _slots.end(), [=](auto const& s) { return s->_owner == tid; });
+    if (spot != _slots.end()) {
+      slot = spot->get();
+    } else {
+      slot = _slots.emplace_back(new Slot(_provider, _hint, tid)).get();
+    }
+  }
+  _local_cache[_id % LOCAL_CACHE_SIZE] = LocalEntry{_id, slot};
+  return slot->_arena;
+}
+
+ConcurrentMemArena&
+ConcurrentMemArena::freeze(size_t n) {
+  std::lock_guard lock{_mutex};
+  for (auto& slot : _slots) {
+    slot->_arena.freeze(n);
+  }
+  return *this;
+}
+
+ConcurrentMemArena&
+ConcurrentMemArena::thaw() {
+  std::lock_guard lock{_mutex};
+  for (auto& slot : _slots) {
+    slot->_arena.thaw();
+  }
+  return *this;
+}
+
+ConcurrentMemArena&
+ConcurrentMemArena::clear() {
+  std::lock_guard lock{_mutex};
+  for (auto& slot : _slots) {
+    slot->_arena.clear(_hint);
+  }
+  return *this;
+}
+
+size_t
+ConcurrentMemArena::size() const {
+  std::lock_guard lock{_mutex};
+  size_t zret = 0;
+  for (auto const& slot : _slots) {
+    zret += slot->_arena.size();
+  }
+  return zret;
+}
+
+size_t
+ConcurrentMemArena::allocated_size() const {
+  std::lock_guard lock{_mutex};
+  size_t zret = 0;
+  for (auto const& slot : _slots) {
+    zret += slot->_arena.allocated_size();
+  }
+  return zret;
+}
+
+size_t
+ConcurrentMemArena::reserved_size() const {
+  std::lock_guard lock{_mutex};
+  size_t zret = 0;
+  for (auto const& slot : _slots) {
+    zret += slot->_arena.reserved_size();
+  }
+  return zret;
+}
+
+bool
+ConcurrentMemArena::contains(const void *ptr) const {
+  std::lock_guard lock{_mutex};
+  return std::any_of(_slots.begin(), _slots.end(), [=](auto const& slot) { return slot->_arena.contains(ptr); });
+}
+
+size_t
+ConcurrentMemArena::slot_count() const {
+  std::lock_guard lock{_mutex};
+  return _slots.size();
+}
+
+}} // namespace swoc
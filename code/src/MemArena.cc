@@ -6,7 +6,10 @@
     away when unused.
  */
 #include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "swoc/MemArena.h"
+#include "swoc/bwf_base.h"
 
 namespace swoc { inline namespace SWOC_VERSION_NS {
 
@@ -16,8 +19,11 @@ namespace swoc { inline namespace SWOC_VERSION_NS {
 MemArena::MemArena(swoc::MemArena::self_type&& that)
     : _active_allocated(that._active_allocated), _active_reserved(that._active_reserved)
       , _frozen_allocated(that._frozen_allocated), _frozen_reserved(that._frozen_reserved)
-      , _reserve_hint(that._reserve_hint), _frozen(std::move(that._frozen))
+      , _reserve_hint(that._reserve_hint), _provider(that._provider), _frozen(std::move(that._frozen))
       , _active(std::move(that._active)) {
+#if SWOC_ARENA_STATS
+  _stats = that._stats;
+#endif
   that._active_allocated = that._active_reserved = 0;
   that._frozen_allocated = that._frozen_reserved = 0;
   that._reserve_hint = 0;
@@ -29,6 +35,18 @@ MemArena::construct_self_contained(size_t n) {
   return tmp.make<MemArena>(std::move(tmp));
 }
 
+MemArena *
+MemArena::construct_self_contained(BlockProvider& provider, size_t n) {
+  MemArena tmp{provider, n};
+  return tmp.make<MemArena>(std::move(tmp));
+}
+
+MemArena::BlockProvider&
+MemArena::default_provider() {
+  static MallocBlockProvider provider;
+  return provider;
+}
+
 MemArena&
 MemArena::operator=(swoc::MemArena::self_type&& that) {
   this->clear();
@@ -37,6 +55,10 @@ MemArena::operator=(swoc::MemArena::self_type&& that) {
   std::swap(_frozen_allocated, that._frozen_allocated);
   std::swap(_frozen_reserved, that._frozen_reserved);
   std::swap(_reserve_hint, that._reserve_hint);
+  _provider = that._provider;
+#if SWOC_ARENA_STATS
+  _stats = that._stats;
+#endif
   _active = std::move(that._active);
   _frozen = std::move(that._frozen);
   return *this;
@@ -64,28 +86,75 @@ MemArena::make_block(size_t n) {
   }
 
   // Allocate space for the Block instance and the request memory and construct a Block at the front.
-  // In theory this could use ::operator new(n) but this causes a size mismatch during ::operator delete.
-  // Easier to use malloc and override @c delete.
-  auto free_space = n - sizeof(Block);
+  // The provider may return more memory than requested, in which case all of it is used.
+  auto span = _provider->allocate(n);
+  if (span.size() < n) {
+    throw std::bad_alloc();
+  }
+  auto free_space = span.size() - sizeof(Block);
   _active_reserved += free_space;
-  return new(::malloc(n)) Block(free_space);
+#if SWOC_ARENA_STATS
+  ++_stats.blocks_created;
+  _stats.reserved += free_space;
+#endif
+  return new(span.data()) Block(free_space);
+}
+
+void
+MemArena::release_block(BlockProvider& provider, Block *block) {
+  provider.release(block->span());
 }
 
 MemSpan<void>
-MemArena::alloc(size_t n) {
+MemArena::alloc(size_t n, size_t align) {
   MemSpan<void> zret;
-  this->require(n);
+  this->require(n, align);
   auto block = _active.head();
-  zret = block->alloc(n);
-  _active_allocated += n;
-  // If this block is now full, move it to the back.
-  if (block->is_full() && block != _active.tail()) {
+  auto pad = block->padding(align);
+#if SWOC_ARENA_STATS
+  bool full_p = block->is_full();
+#endif
+  zret = block->alloc(n, align);
+  _active_allocated += n + pad;
+#if SWOC_ARENA_STATS
+  ++_stats.allocations;
+  _stats.requested += n;
+  ++_stats.histogram[Stats::bucket(n)];
+  _stats.peak_allocated = std::max(_stats.peak_allocated, this->allocated_size());
+  if (!full_p && block->is_full()) {
+    _stats.waste += block->remaining();
+  }
+#endif
+  // If this block is now full, move it to the back. Not done if there is a checkpoint, to keep
+  // the blocks in stack order.
+  if (block->is_full() && block != _active.tail() && _checkpoint_count == 0) {
     _active.erase(block);
     _active.append(block);
   }
   return zret;
 }
 
+MemSpan<void>
+MemArena::extend(MemSpan<void> span, size_t n) {
+  if (n <= span.size()) {
+    return span;
+  }
+  auto block = _active.head();
+  auto delta = n - span.size();
+  // Must be the last allocation in the current block, with enough space after it.
+  if (nullptr == block || static_cast<char *>(span.data()) + span.size() != block->data() + block->allocated ||
+      delta > block->remaining()) {
+    return {};
+  }
+  block->alloc(delta);
+  _active_allocated += delta;
+#if SWOC_ARENA_STATS
+  _stats.requested += delta;
+  _stats.peak_allocated = std::max(_stats.peak_allocated, this->allocated_size());
+#endif
+  return {span.data(), n};
+}
+
 MemArena&
 MemArena::freeze(size_t n) {
   this->destroy_frozen();
@@ -116,24 +185,31 @@ MemArena::contains(const void *ptr) const {
          std::any_of(_frozen.begin(), _frozen.end(), pred);
 }
 
+static_assert(sizeof(MemArena::Block) % alignof(std::max_align_t) == 0, "Block data must be maximally aligned");
+
 MemArena&
-MemArena::require(size_t n) {
+MemArena::require(size_t n, size_t align) {
   auto spot = _active.begin();
   Block *block{nullptr};
+  // Block data is aligned at least this strictly, any stricter alignment may need padding.
+  auto slop = align > alignof(std::max_align_t) ? align - alignof(std::max_align_t) : 0;
 
-  if (spot == _active.end()) {
-    block = this->make_block(n);
+  if (spot == _active.end() || (_checkpoint_count && n + spot->padding(align) > spot->remaining())) {
+    // No blocks, or a checkpoint exists and the most recent block is too small.
+    block = this->make_block(n + slop);
     _active.prepend(block);
+  } else if (_checkpoint_count) {
+    // Stack order - the most recent block has enough space.
   } else {
     // Search back through the list until a full block is hit, which is a miss.
-    while (spot != _active.end() && n > spot->remaining()) {
+    while (spot != _active.end() && n + spot->padding(align) > spot->remaining()) {
       if (spot->is_full())
         spot = _active.end();
       else
         ++spot;
     }
     if (spot == _active.end()) { // no block has enough free space
-      block = this->make_block(n);
+      block = this->make_block(n + slop);
       _active.prepend(block);
     } else if (spot != _active.begin()) {
       // big enough space, if it's not at the head, move it there.
@@ -145,14 +221,38 @@ MemArena::require(size_t n) {
   return *this;
 }
 
+MemArena&
+MemArena::rollback(Checkpoint const& mark) {
+  // Blocks in front of the checkpoint block were all created after the checkpoint.
+  for (Block *block = _active.head(); block && block != mark._block; block = _active.head()) {
+    _active.take_head();
+    _active_reserved -= block->size;
+#if SWOC_ARENA_STATS
+    ++_stats.blocks_freed;
+#endif
+    release_block(*_provider, block);
+  }
+  if (mark._block) {
+    mark._block->allocated = mark._offset;
+  }
+  _active_allocated = mark._active_allocated;
+  return *this;
+}
+
 void
 MemArena::destroy_active() {
-  _active.apply([](Block *b) { delete b; }).clear();
+#if SWOC_ARENA_STATS
+  _stats.blocks_freed += _active.count();
+#endif
+  _active.apply([this](Block *b) { release_block(*_provider, b); }).clear();
 }
 
 void
 MemArena::destroy_frozen() {
-  _frozen.apply([](Block *b) { delete b; }).clear();
+#if SWOC_ARENA_STATS
+  _stats.blocks_freed += _frozen.count();
+#endif
+  _frozen.apply([this](Block *b) { release_block(*_provider, b); }).clear();
 }
 
 MemArena&
@@ -178,6 +278,7 @@ MemArena::discard(size_t hint) {
 
 MemArena::~MemArena() {
   // Destruct in a way that makes it safe for the instance to be in one of its own memory blocks.
+  BlockProvider& provider = *_provider;
   Block *ba = _active.head();
   Block *bf = _frozen.head();
   _active.clear();
@@ -185,13 +286,192 @@ MemArena::~MemArena() {
   while (bf) {
     Block *b = bf;
     bf = bf->_link._next;
-    delete b;
+    release_block(provider, b);
   }
   while (ba) {
     Block *b = ba;
     ba = ba->_link._next;
-    delete b;
+    release_block(provider, b);
+  }
+}
+
+BufferWriter&
+bwformat(BufferWriter& w, bwf::Spec const&, MemArena::Stats const& stats) {
+  w.print("blocks created {} freed {}, allocations {}, requested {} reserved {} waste {} peak {}, sizes ["
+          , stats.blocks_created, stats.blocks_freed, stats.allocations, stats.requested, stats.reserved
+          , stats.waste, stats.peak_allocated);
+  auto sep = "";
+  for (unsigned k = 0; k < MemArena::Stats::N_BUCKETS; ++k) {
+    if (auto count = stats.histogram[k]; count) {
+      if (k == 0) {
+        w.print("{}0:{}", sep, count);
+      } else if (k == MemArena::Stats::N_BUCKETS - 1) {
+        w.print("{}>={}:{}", sep, size_t(1) << (k - 1), count);
+      } else {
+        w.print("{}<{}:{}", sep, size_t(1) << k, count);
+      }
+      sep = " ";
+    }
   }
+  return w.write(']');
+}
+
+// --- Block providers
+
+MallocBlockProvider::MallocBlockProvider(size_t align) : _align(std::max(align, alignof(std::max_align_t))) {}
+
+MemSpan<void>
+MallocBlockProvider::allocate(size_t n) {
+  void *ptr = nullptr;
+  if (_align > alignof(std::max_align_t)) {
+    n   = (n + _align - 1) & ~(_align - 1);
+    ptr = ::aligned_alloc(_align, n);
+  } else {
+    ptr = ::malloc(n);
+  }
+  return ptr ? MemSpan<void>{ptr, n} : MemSpan<void>{};
+}
+
+void
+MallocBlockProvider::release(MemSpan<void> span) {
+  ::free(span.data());
+}
+
+MmapBlockProvider::MmapBlockProvider(Pages pages, size_t huge_page_size)
+    : _pages(pages), _page_size(::sysconf(_SC_PAGESIZE)), _huge_page_size(huge_page_size) {
+#if !defined(MADV_HUGEPAGE)
+  _pages = Pages::SMALL;
+#endif
+}
+
+MemSpan<void>
+MmapBlockProvider::map_aligned(size_t n, size_t align) {
+  // Map enough extra to find an aligned start, then unmap the excess on each side.
+  auto ptr = ::mmap(nullptr, n + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    return {};
+  }
+  auto base  = static_cast<char *>(ptr);
+  auto start = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(base) + align - 1) & ~(align - 1));
+  if (start > base) {
+    ::munmap(base, start - base);
+  }
+  if (auto tail = (base + n + align) - (start + n); tail > 0) {
+    ::munmap(start + n, tail);
+  }
+  return {start, n};
+}
+
+MemSpan<void>
+MmapBlockProvider::allocate(size_t n) {
+  n = (n + _page_size - 1) & ~(_page_size - 1);
+#if defined(MAP_HUGETLB)
+  if (_pages == Pages::HUGETLB) {
+    auto size = (n + _huge_page_size - 1) & ~(_huge_page_size - 1);
+    auto ptr  = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      return {ptr, size};
+    }
+    // No huge pages reserved, use transparent huge pages instead.
+  }
+#endif
+#if defined(MADV_HUGEPAGE)
+  if (_pages != Pages::SMALL && n >= _huge_page_size) {
+    n = (n + _huge_page_size - 1) & ~(_huge_page_size - 1);
+    auto span = map_aligned(n, _huge_page_size);
+    if (span.data()) {
+      ::madvise(span.data(), span.size(), MADV_HUGEPAGE); // advisory only, failure is harmless.
+    }
+    return span;
+  }
+#endif
+  auto ptr = ::mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return ptr == MAP_FAILED ? MemSpan<void>{} : MemSpan<void>{ptr, n};
+}
+
+void
+MmapBlockProvider::release(MemSpan<void> span) {
+  ::munmap(span.data(), span.size());
+}
+
+RegionBlockProvider::RegionBlockProvider(MemSpan<void> region) {
+  // Align the start of the region.
+  auto base  = static_cast<char *>(region.data());
+  auto start = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(base) + ALIGN - 1) & ~(ALIGN - 1));
+  auto skip  = std::min<size_t>(start - base, region.size());
+  _region    = region.subspan(skip, region.size() - skip);
+  _base      = static_cast<char *>(_region.data());
+}
+
+MemSpan<void>
+RegionBlockProvider::allocate(size_t n) {
+  n = (n + ALIGN - 1) & ~(ALIGN - 1);
+  if (n > _region.size()) {
+    return {};
+  }
+  MemSpan<void> zret = _region.prefix(n);
+  _region            = _region.subspan(n, _region.size() - n);
+  ++_count;
+  return zret;
+}
+
+void
+RegionBlockProvider::release(MemSpan<void> span) {
+  auto end = static_cast<char *>(_region.data());
+  if (--_count == 0) { // everything released, reset the region.
+    _region.assign(_base, _region.size() + (end - _base));
+  } else if (static_cast<char *>(span.data()) + ((span.size() + ALIGN - 1) & ~(ALIGN - 1)) == end) {
+    // Most recent slice, give it back.
+    _region.assign(span.data(), _region.size() + (end - static_cast<char *>(span.data())));
+  }
+}
+
+CachingBlockProvider::CachingBlockProvider(size_t max_retained, MemArena::BlockProvider& provider)
+    : _provider(provider), _max_retained(max_retained) {}
+
+CachingBlockProvider::~CachingBlockProvider() {
+  this->clear();
+}
+
+MemSpan<void>
+CachingBlockProvider::allocate(size_t n) {
+  // Best fit - use the smallest cached block that is large enough.
+  for (Item **spot = &_head; *spot; spot = &(*spot)->_next) {
+    if (Item *item = *spot; item->_size >= n) {
+      *spot = item->_next;
+      _retained -= item->_size;
+      --_count;
+      return {item, item->_size};
+    }
+  }
+  return _provider.allocate(n);
+}
+
+void
+CachingBlockProvider::release(MemSpan<void> span) {
+  if (span.size() < sizeof(Item) || _retained + span.size() > _max_retained) {
+    _provider.release(span);
+    return;
+  }
+  Item **spot = &_head;
+  while (*spot && (*spot)->_size < span.size()) {
+    spot = &(*spot)->_next;
+  }
+  *spot      = new (span.data()) Item{span.size(), *spot};
+  _retained += span.size();
+  ++_count;
+}
+
+CachingBlockProvider&
+CachingBlockProvider::clear() {
+  while (_head) {
+    Item *item = _head;
+    _head      = item->_next;
+    _provider.release({item, item->_size});
+  }
+  _retained = 0;
+  _count    = 0;
+  return *this;
 }
 
 }} // namespace swoc
@@ -5,11 +5,11 @@
 
     Example of a variant of IPSpace optimized for fast loading.
 
-    This will build the flat files if given the --build option.
+    This will build the flat file if given the --build option.
 
-    This will look up addresses from the flat files given the --find option.
+    This will look up addresses from the flat file given the --find option.
 
-    Build flat files from "data.csv"
+    Build flat file from "data.csv"
     --build data.csv
 
     Lookup some addresses.
@@ -19,12 +19,9 @@
     --build data.csv --find 172.17.18.19 2001:BADF::0E0E
 */
 
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/mman.h>
-
 #include "swoc/TextView.h"
 #include "swoc/swoc_ip.h"
+#include "swoc/IPSpaceView.h"
 #include "swoc/bwf_ip.h"
 #include "swoc/bwf_ex.h"
 #include "swoc/bwf_std.h"
@@ -43,113 +40,13 @@ using swoc::IPAddr;
 using swoc::IP4Addr;
 using swoc::IP6Addr;
 using swoc::IPSpace;
+using swoc::IPSpaceView;
 
 // Temp for error messages.
 std::string err_text;
 
-/** Allocate a span of type @a T.
- *
- * @tparam T Element type.
- * @param n Number of elements.
- * @return A @c MemSpan<T> with @a n elements.
- */
-template < typename T > MemSpan<T> span_alloc(size_t n) {
-  size_t bytes = sizeof(T) * n;
-  return { static_cast<T*>(malloc(bytes)), n };
-}
-
-// Array type for flat files.
-// Each flat file is an instance of this, which is a wrapper over an array of its nodes.
-template < typename METRIC, typename PAYLOAD > class IPArray {
-public:
-  struct Node {
-    METRIC _min;
-    METRIC _max;
-    PAYLOAD _payload;
-  };
-
-  /** Load from array already in memory.
-   *
-   * @param span Memory containing the array.
-   *
-   * The presumption is @a span has been brough in to memory from a file via @c mmap.
-   */
-  IPArray(MemSpan<Node> span) : _nodes(span) {}
-
-  /** Load from a @a space.
-   *
-   * @param space Populated IPSpace.
-   *
-   * This will allocate memory to hold an array that mirrors the data in @a space.
-   */
-  IPArray(IPSpace<PAYLOAD> const& space);
-
-  /** Find @a addr.
-   *
-   * @param addr Search value.
-   * @return The node that contains @a addr, or @c nullptr if not found.
-   */
-  Node* find(METRIC const& addr);
-
-  Errata store(swoc::file::path const& path);
-
-  size_t size() const { return _nodes.size(); }
-  void* data() const { return _nodes.data(); }
-
-protected:
-  /// Array memory.
-  MemSpan<Node> _nodes;
-};
-
-// Standard binary search on a sorted array.
-template < typename METRIC, typename PAYLOAD > auto IPArray<METRIC, PAYLOAD>::find(METRIC const& addr) -> Node* {
-  ssize_t lidx = 0;
-  ssize_t ridx = _nodes.count() - 1;
-
-  while (lidx <= ridx) { // still some array left to search.
-    auto idx = (lidx + ridx) / 2; // Look at the middle element.
-    auto n = _nodes.data() + idx;
-    if (addr < n->_min) { // target is to the left
-      ridx = idx - 1;
-    } else if (addr > n->_max) { // target is to the right
-      lidx = idx + 1;
-    } else { // target is right here, done.
-      return n;
-    }
-  }
-  return nullptr; // dropped out of the loop -> not found.
-}
-
-template < typename METRIC, typename PAYLOAD > IPArray<METRIC, PAYLOAD>::IPArray(IPSpace<PAYLOAD> const& space) {
-  auto n = space.count(METRIC::AF_value);
-  _nodes = { span_alloc<Node>(n) }; // In memory array.
-  auto node = _nodes.data();
-  // Update the array with all IPv4 ranges.
-  for ( auto spot = space.begin(METRIC::AF_value), limit = space.end(METRIC::AF_value) ; spot != limit ; ++spot, ++node ) {
-    auto && [ range, payload ] { *spot };
-    node->_min = static_cast<METRIC>(range.min());
-    node->_max = static_cast<METRIC>(range.max());
-    node->_payload = payload;
-  }
-
-}
-
-template < typename METRIC, typename PAYLOAD > Errata IPArray<METRIC, PAYLOAD>::store(swoc::file::path const& path) {
-  auto fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
-  if (fd >= 0) {
-    auto written = ::write(fd, _nodes.data(), _nodes.size());
-    if (written != _nodes.size()) {
-      return Errata().error("Failed to write IP4 output - {} of {} bytes written to '{}' [{}]\n", written, _nodes.size(), path, swoc::bwf::Errno{});
-    }
-    close(fd);
-  } else {
-    return Errata().error("Failed to open IP4 output '{}' [{}]\n", path, swoc::bwf::Errno{});
-  }
-  return {};
-}
-
-using A4 = IPArray<IP4Addr, unsigned>;
-using A6 = IPArray<IP6Addr, unsigned>;
+/// Payload schema tag for the flat file.
+static constexpr uint64_t PAYLOAD_TAG = 0x756e7369676e6564; // "unsigned"
 
 // Load the CSV file @a src into @a space.
 void build(IPSpace<unsigned> & space, swoc::file::path src) {
@@ -168,8 +65,7 @@ void build(IPSpace<unsigned> & space, swoc::file::path src) {
 }
 
 int main(int argc, char const *argv[]) {
-  swoc::file::path path_4{"/tmp/ip4.mem"};
-  swoc::file::path path_6{"/tmp/ip6.mem"};
+  swoc::file::path path{"/tmp/ip_space.mem"};
   swoc::file::path src;
 
   MemSpan<char const*> args{argv, size_t(argc)};
@@ -178,7 +74,7 @@ int main(int argc, char const *argv[]) {
     exit(0); // nothing to do.
   }
 
-  // Check if the array files need to be built.
+  // Check if the flat file needs to be built.
   if (0 == strcasecmp("--build"_tv, args.front())) {
     IPSpace<unsigned int> space;
     args.remove_prefix(1);
@@ -186,11 +82,7 @@ int main(int argc, char const *argv[]) {
       build(space, swoc::file::path(args[0]));
       args.remove_prefix(1);
     }
-    if ( auto errata = A4(space).store(path_4) ; !errata.is_ok() ) {
-      std::cerr << errata << std::endl;
-      exit(1);
-    }
-    if (auto errata = A6(space).store(path_6) ; !errata.is_ok()) {
+    if (auto errata = space.freeze().store(path, PAYLOAD_TAG) ; !errata.is_ok()) {
       std::cerr << errata << std::endl;
       exit(1);
     }
@@ -207,34 +99,15 @@ int main(int argc, char const *argv[]) {
     exit(1);
   }
 
-  std::error_code ec;
-
   auto t0 = std::chrono::system_clock::now();
-  // Make sure the flat files are there.
-  auto stat_4 = swoc::file::status(path_4, ec);
-  if (ec) {
-    std::cerr << swoc::bwprint(err_text, "Flat file for IPv4 '{}' not found. {}\n", path_4, ec);
-    exit(1);
-  }
-
-  auto stat_6 = swoc::file::status(path_6, ec);
-  if (ec) {
-    std::cerr << swoc::bwprint(err_text, "Flat file for IPv6 '{}' not found. {}\n", path_6, ec);
+  // map the flat file in to memory.
+  IPSpaceView<unsigned> view;
+  if (auto errata = view.map(path, PAYLOAD_TAG) ; !errata.is_ok()) {
+    std::cerr << errata << std::endl;
     exit(1);
   }
 
-  // map the flat files in to memory.
-  auto fsize = swoc::file::file_size(stat_4);
-  auto fd_4 = ::open(path_4.c_str(), O_RDONLY);
-  MemSpan<void> mem4 { ::mmap(nullptr, fsize, PROT_READ, MAP_PRIVATE, fd_4, 0), size_t(fsize) };
-  A4 a_4 { mem4.rebind<A4::Node>() };
-
-  fsize = swoc::file::file_size(stat_6);
-  auto fd_6 = ::open(path_6.c_str(), O_RDONLY);
-  MemSpan<void> mem6 { ::mmap(nullptr, fsize, PROT_READ, MAP_PRIVATE, fd_6, 0), size_t(fsize) };
-  A6 a_6 { mem6.rebind<A6::Node>() };
-
-  std::cout << swoc::bwprint(err_text, "Mapped files in {} us\n", std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - t0).count());
+  std::cout << swoc::bwprint(err_text, "Mapped file in {} us\n", std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - t0).count());
 
   #if 0
   // performance testing.
@@ -242,33 +115,22 @@ int main(int argc, char const *argv[]) {
   auto step = ~0U / 10000000;
   IP4Addr addr {in_addr_t(1)};
   for ( unsigned idx = 0 ; idx < 10000000 ; ++idx ) {
-    [[maybe_unused]] auto n = a_4.find(addr);
+    [[maybe_unused]] auto n = view.find(addr);
     addr = addr.host_order() + step;
   }
   auto delta = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - t0);
-  std::cout << swoc::bwprint(err_text, "Searched files in {} ns - {} ns / lookup\n", delta.count(), delta.count() / 10000000);
+  std::cout << swoc::bwprint(err_text, "Searched file in {} ns - {} ns / lookup\n", delta.count(), delta.count() / 10000000);
   #endif
 
-  // Now the in memory flat files can be searched.
+  // Now the in memory flat file can be searched.
   while (! args.empty()) {
     IPAddr addr;
     if (addr.load(args.front())) {
-      if (addr.is_ip4()) {
-        auto n = a_4.find(addr.ip4());
-        if (n) {
-          std::cout << swoc::bwprint(err_text, "{} -> {}\n", addr, n->_payload);
-        } else {
-          std::cout << swoc::bwprint(err_text, "{} not found\n", addr);
-        }
-      } else if (addr.is_ip6()) {
-        auto n = a_6.find(addr.ip6());
-        if (n) {
-          std::cout << swoc::bwprint(err_text, "{} -> {}\n", addr, n->_payload);
-        } else {
-          std::cout << swoc::bwprint(err_text, "{} not found\n", addr);
-        }
+      if (auto payload = view.find(addr) ; payload) {
+        std::cout << swoc::bwprint(err_text, "{} -> {}\n", addr, *payload);
+      } else {
+        std::cout << swoc::bwprint(err_text, "{} not found\n", addr);
       }
-
     } else {
       std::cerr << swoc::bwprint(err_text, "Unrecognized address '{}'\n", args.front());
     }
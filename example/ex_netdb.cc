@@ -137,7 +137,7 @@ struct Payload {
   FlagSet _flags; ///< Flags.
 
   /// @return @c true if @a this is equal to @a that.
-  bool operator == (Payload const& that) {
+  bool operator == (Payload const& that) const {
     return _type == that._type &&
     _owner == that._owner &&
     _pod == that._pod &&
@@ -146,7 +146,7 @@ struct Payload {
   }
 
   /// @return @c true if @a this is not equal to @a that.
-  bool operator != (Payload const& that) {
+  bool operator != (Payload const& that) const {
     return ! (*this == that);
   }
 };
@@ -12,6 +12,7 @@
 #include <limits>
 
 #include "swoc/TextView.h"
+#include "swoc/ArenaVector.h"
 #include "swoc/swoc_ip.h"
 #include "swoc/bwf_ip.h"
 #include "swoc/bwf_std.h"
@@ -302,15 +303,16 @@ public:
 
 protected:
   size_t _size = 0; ///< Size of row data.
+
+  MemArena _arena; ///< Arena for storing rows.
+
   /// Defined properties for columns.
-  std::vector<Property::Handle> _columns;
+  swoc::ArenaVector<Property::Handle> _columns{_arena};
 
   /// IPSpace type.
   using space = IPSpace<Row>;
   space _space; ///< IPSpace instance.
 
-  MemArena _arena; ///< Arena for storing rows.
-
   /** Extract the next token from the line.
    *
    * @param line Current line [in,out]
@@ -386,6 +386,31 @@ TEST_CASE("ArenaWriter print", "[BW][ArenaWriter]")
   REQUIRE(valid_p == true);
 }
 
+TEST_CASE("ArenaWriter growth", "[BW][ArenaWriter]")
+{
+  swoc::MemArena arena{64};
+  swoc::ArenaWriter aw{arena};
+  static constexpr size_t N = 1 << 20;
+  unsigned reallocs         = 0;
+  auto capacity             = aw.capacity();
+
+  for (size_t i = 0; i < N; ++i) {
+    aw.write(char('a' + i % 26));
+    if (aw.capacity() != capacity) {
+      REQUIRE(aw.capacity() >= 2 * capacity);
+      capacity = aw.capacity();
+      ++reallocs;
+    }
+  }
+  REQUIRE(aw.size() == N);
+  REQUIRE(reallocs < 20);
+  auto view = aw.view();
+  for (size_t i = 0; i < N; i += 4099) {
+    REQUIRE(view[i] == char('a' + i % 26));
+  }
+  REQUIRE(arena.alloc(N).data() == aw.data());
+}
+
 #if 0
 // Need Endpoint or some other IP address parsing support to load the test values.
 TEST_CASE("BufferWriter IP", "[libswoc][ip][bwf]") {
@@ -23,8 +23,11 @@
 #include <string>
 #include <bitset>
 #include <random>
+#include <thread>
 
 #include "swoc/IntrusiveHashMap.h"
+#include "swoc/FlatHashMap.h"
+#include "swoc/ShardedIntrusiveHashMap.h"
 #include "swoc/bwf_base.h"
 #include "catch.hpp"
 
@@ -47,6 +50,7 @@ struct Thing {
 
   Thing *_next{nullptr};
   Thing *_prev{nullptr};
+  size_t _hash{0}; ///< Cached hash, if the descriptor supports it.
 };
 
 struct ThingMapDescriptor {
@@ -80,6 +84,55 @@ struct ThingMapDescriptor {
 
 using Map = IntrusiveHashMap<ThingMapDescriptor>;
 
+struct Pow2Descriptor : public ThingMapDescriptor {
+  using bucket_sizing = swoc::bucket_sizing::PowerOfTwo<>;
+};
+
+struct FastRangeDescriptor : public ThingMapDescriptor {
+  using bucket_sizing = swoc::bucket_sizing::FastRange;
+};
+
+// Cache the hash in the element, and count the number of times a key is hashed.
+struct CachedHashDescriptor : public ThingMapDescriptor {
+  static inline unsigned hash_count = 0;
+
+  static size_t &
+  cached_hash(Thing *thing)
+  {
+    return thing->_hash;
+  }
+  static size_t
+  hash_of(std::string_view s)
+  {
+    ++hash_count;
+    return hasher(s);
+  }
+};
+
+// Fill a map and check every element can be found, for each sizing policy.
+template <typename M>
+void
+check_sizing(M &map, int n)
+{
+  std::vector<std::string> names;
+  names.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    swoc::bwprint(names.emplace_back(), "thing {}", i);
+    map.insert(new Thing(names.back(), i));
+  }
+  REQUIRE(map.count() == size_t(n));
+  bool miss_p = false;
+  for (int i = 0; i < n; ++i) {
+    if (auto spot = map.find(names[i]); spot == map.end() || spot->_n != i) {
+      miss_p = true;
+    }
+  }
+  REQUIRE(miss_p == false);
+  REQUIRE(map.find("not a thing"sv) == map.end());
+  map.apply([](Thing *thing) { delete thing; });
+  map.clear();
+}
+
 } // namespace
 
 TEST_CASE("IntrusiveHashMap", "[libts][IntrusiveHashMap]")
@@ -235,5 +288,325 @@ TEST_CASE("IntrusiveHashMapManyStrings", "[IntrusiveHashMap]")
   REQUIRE(miss_p == false);
 };
 
+TEST_CASE("IntrusiveHashMap incremental expansion", "[IntrusiveHashMap]")
+{
+  constexpr int N = 2000;
+  Map map;
+  map.set_expansion_step(1);
+  REQUIRE(map.get_expansion_step() == 1);
+
+  std::vector<std::string> names;
+  names.reserve(N);
+  for (int i = 0; i < N; ++i) {
+    swoc::bwprint(names.emplace_back(), "name {}", i);
+  }
+
+  bool expanding_p = false;
+  bool miss_p      = false;
+  for (int i = 0; i < N; ++i) {
+    map.insert(new Thing(names[i], i));
+    // Duplicates of every 10th key, inserted while buckets are being moved.
+    if (i % 10 == 0) {
+      map.insert(new Thing(names[i], N + i));
+    }
+    expanding_p = expanding_p || map.is_expanding();
+    // Spot check earlier keys, which may be in either bucket array.
+    for (int j = i; j >= 0; j -= 97) {
+      if (auto spot = map.find(names[j]); spot == map.end() || spot->_n != j) {
+        miss_p = true;
+      }
+    }
+  }
+  REQUIRE(expanding_p);
+  REQUIRE(miss_p == false);
+  REQUIRE(map.count() == N + N / 10);
+
+  // Erase some elements, possibly while still expanding.
+  for (int i = 5; i < N; i += 10) {
+    auto spot = map.find(names[i]);
+    REQUIRE(spot != map.end());
+    Thing *thing = &*spot;
+    map.erase(spot);
+    delete thing;
+  }
+  REQUIRE(map.count() == N);
+
+  // Duplicates must be adjacent, no matter which array they are in.
+  for (int i = 0; i < N; i += 10) {
+    auto r = map.equal_range(names[i]);
+    REQUIRE(std::distance(r.begin(), r.end()) == 2);
+  }
+
+  map.migrate(map.bucket_count());
+  REQUIRE(map.is_expanding() == false);
+  for (int i = 0; i < N; ++i) {
+    if ((map.find(names[i]) == map.end()) != (i % 10 == 5)) {
+      miss_p = true;
+    }
+  }
+  REQUIRE(miss_p == false);
+  REQUIRE(std::distance(map.begin(), map.end()) == N);
+
+  map.apply([](Thing *thing) { delete thing; });
+  map.clear();
+  REQUIRE(map.count() == 0);
+}
+
+TEST_CASE("IntrusiveHashMap bucket sizing", "[IntrusiveHashMap]")
+{
+  using swoc::bucket_sizing::FastRange;
+  using swoc::bucket_sizing::PowerOfTwo;
+  using swoc::bucket_sizing::Prime;
+
+  static_assert(std::is_same_v<Map::sizing_type, Prime>);
+  REQUIRE(Prime::initial(7) == 7);
+  REQUIRE(Prime::next(7) == 13);
+  REQUIRE(PowerOfTwo<>::initial(7) == 8);
+  REQUIRE(PowerOfTwo<>::initial(8) == 8);
+  REQUIRE(PowerOfTwo<>::next(8) == 16);
+  REQUIRE(PowerOfTwo<false>::index(0x1234u, 256) == 0x34);
+  // Mixing must spread low bits that are all the same.
+  std::bitset<16> marks;
+  for (uint32_t i = 0; i < 16; ++i) {
+    marks[PowerOfTwo<>::index(i << 16, 16)] = true;
+  }
+  REQUIRE(marks.count() > 8);
+  REQUIRE(FastRange::index(uint32_t(0), 10) == 0);
+  REQUIRE(FastRange::index(~uint32_t(0), 10) == 9);
+  REQUIRE(FastRange::index(~uint64_t(0), 10) == 9);
+  REQUIRE(FastRange::index(uint64_t(1) << 63, 10) == 5);
+  REQUIRE(FastRange::multiply_high(~uint64_t(0), ~uint64_t(0)) == ~uint64_t(1));
+  REQUIRE(FastRange::multiply_high(0x123456789ABCDEF0ULL, 0x0FEDCBA987654321ULL) == 0x121FA00AD77D742ULL);
+
+  IntrusiveHashMap<Pow2Descriptor> pow2_map;
+  check_sizing(pow2_map, 1000);
+  auto nb = pow2_map.bucket_count();
+  REQUIRE((nb & (nb - 1)) == 0);
+  REQUIRE(nb > IntrusiveHashMap<Pow2Descriptor>::DEFAULT_BUCKET_COUNT);
+
+  IntrusiveHashMap<FastRangeDescriptor> fr_map;
+  fr_map.set_expansion_step(2);
+  check_sizing(fr_map, 1000);
+  REQUIRE(fr_map.bucket_count() > IntrusiveHashMap<FastRangeDescriptor>::DEFAULT_BUCKET_COUNT);
+}
+
+TEST_CASE("IntrusiveHashMap cached hash", "[IntrusiveHashMap]")
+{
+  using CMap = IntrusiveHashMap<CachedHashDescriptor>;
+  static_assert(CMap::HASH_CACHED_P);
+  static_assert(!Map::HASH_CACHED_P);
+  constexpr int N = 1000;
+
+  for (size_t step : {0, 1}) {
+    CMap map;
+    map.set_expansion_step(step);
+    auto nb                          = map.bucket_count();
+    CachedHashDescriptor::hash_count = 0;
+    check_sizing(map, N);
+    REQUIRE(map.bucket_count() > nb);
+    // One hash per insert and one per lookup, none for the expansions.
+    REQUIRE(CachedHashDescriptor::hash_count == 2 * N + 1);
+  }
+
+  // Removal uses the cached hash.
+  CMap map;
+  auto thing = new Thing("bob"sv);
+  map.insert(thing);
+  REQUIRE(thing->_hash == ThingMapDescriptor::hasher("bob"sv));
+  CachedHashDescriptor::hash_count = 0;
+  REQUIRE(map.erase(thing));
+  REQUIRE(CachedHashDescriptor::hash_count == 0);
+  REQUIRE(map.count() == 0);
+  delete thing;
+}
+
+namespace
+{
+// Values stored directly in a FlatHashMap.
+struct Record {
+  std::string _name;
+  int _n{0};
+};
+
+struct RecordDescriptor {
+  static std::string_view
+  key_of(Record *r)
+  {
+    return r->_name;
+  }
+  static size_t
+  hash_of(std::string_view s)
+  {
+    return std::hash<std::string_view>{}(s);
+  }
+  static bool
+  equal(std::string_view lhs, std::string_view rhs)
+  {
+    return lhs == rhs;
+  }
+};
+} // namespace
+
+TEST_CASE("FlatHashMap", "[FlatHashMap]")
+{
+  constexpr int N = 1000;
+  std::vector<std::string> names;
+  names.reserve(N);
+  for (int i = 0; i < N; ++i) {
+    swoc::bwprint(names.emplace_back(), "name {}", i);
+  }
+
+  // Pointers to elements, with the descriptor for IntrusiveHashMap.
+  swoc::FlatHashMap<ThingMapDescriptor, Thing *> map;
+  REQUIRE(map.empty());
+  REQUIRE(map.find("name 0"sv) == map.end());
+  std::vector<std::unique_ptr<Thing>> things;
+  for (int i = 0; i < N; ++i) {
+    things.emplace_back(new Thing(names[i], i));
+    REQUIRE(map.insert(things.back().get()).second);
+  }
+  REQUIRE(map.count() == N);
+  REQUIRE(map.capacity() * 7 / 8 >= N);
+  Thing dup{names[17], -1};
+  auto [spot, inserted_p] = map.insert(&dup);
+  REQUIRE_FALSE(inserted_p);
+  REQUIRE((*spot)->_n == 17);
+  REQUIRE(std::distance(map.begin(), map.end()) == N);
+
+  for (int i = 0; i < N; i += 2) {
+    REQUIRE(map.erase(names[i]) == 1);
+  }
+  REQUIRE(map.erase(names[0]) == 0);
+  REQUIRE(map.count() == N / 2);
+  bool miss_p = false;
+  for (int i = 0; i < N; ++i) {
+    auto loc = map.find(names[i]);
+    if ((i & 1) ? (loc == map.end() || (*loc)->_n != i) : loc != map.end()) {
+      miss_p = true;
+    }
+  }
+  REQUIRE(miss_p == false);
+
+  // Churn should reuse deleted slots rather than grow the table.
+  auto cap = map.capacity();
+  for (int k = 0; k < 10; ++k) {
+    for (int i = 0; i < N; i += 2) {
+      map.insert(things[i].get());
+    }
+    for (int i = 0; i < N; i += 2) {
+      map.erase(names[i]);
+    }
+  }
+  REQUIRE(map.capacity() <= 2 * cap);
+  REQUIRE(map.count() == N / 2);
+  map.clear();
+  REQUIRE(map.empty());
+  REQUIRE(map.begin() == map.end());
+
+  // Values, which must be destroyed by the map.
+  swoc::FlatHashMap<RecordDescriptor, Record> records{N};
+  auto rcap = records.capacity();
+  for (int i = 0; i < N; ++i) {
+    REQUIRE(records.emplace(Record{names[i], i}).second);
+  }
+  REQUIRE(records.capacity() == rcap);
+  REQUIRE(records.contains("name 999"sv));
+  REQUIRE_FALSE(records.contains("name 1000"sv));
+  REQUIRE(records.find("name 500"sv)->_n == 500);
+  for (auto& r : records) {
+    r._n += N;
+  }
+  auto const& crecords = records;
+  int total            = 0;
+  for (auto const& r : crecords) {
+    total += r._n - N;
+  }
+  REQUIRE(total == N * (N - 1) / 2);
+  records.erase(records.find("name 1"sv));
+  REQUIRE(records.count() == N - 1);
+
+  auto moved{std::move(records)};
+  REQUIRE(moved.count() == N - 1);
+  REQUIRE(records.count() == 0);
+  REQUIRE(records.find("name 2"sv) == records.end());
+  REQUIRE(moved.find("name 2"sv)->_n == 2 + N);
+}
+
+TEST_CASE("ShardedIntrusiveHashMap", "[IntrusiveHashMap]")
+{
+  constexpr int N_THREADS = 8;
+  constexpr int N         = 1000; // per thread.
+  using SMap              = swoc::ShardedIntrusiveHashMap<ThingMapDescriptor, 16>;
+  SMap map;
+
+  std::vector<std::string> names;
+  names.reserve(N_THREADS * N);
+  for (int i = 0; i < N_THREADS * N; ++i) {
+    swoc::bwprint(names.emplace_back(), "thing {}", i);
+  }
+
+  // Each thread inserts its own things, then looks up all of them and erases the odd ones.
+  std::atomic<int> miss_count{0};
+  auto worker = [&](int t) {
+    int base = t * N;
+    for (int i = base; i < base + N; ++i) {
+      map.insert(new Thing(names[i], i));
+    }
+    for (int i = base; i < base + N; ++i) {
+      if (!map.find(names[i], [&](Thing &thing) {
+            if (thing._n != i)
+              ++miss_count;
+          })) {
+        ++miss_count;
+      }
+    }
+    for (int i = base + 1; i < base + N; i += 2) {
+      Thing *thing = map.find(names[i]);
+      if (thing == nullptr || !map.erase(thing)) {
+        ++miss_count;
+      }
+      delete thing;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int t = 0; t < N_THREADS; ++t) {
+    threads.emplace_back(worker, t);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  REQUIRE(miss_count == 0);
+  REQUIRE(map.count() == N_THREADS * N / 2);
+  REQUIRE(map.contains(names[0]));
+  REQUIRE_FALSE(map.contains(names[1]));
+  REQUIRE(map.shard_for(names[2]) < SMap::SHARD_COUNT);
+
+  // Per shard iteration, and every shard should be used.
+  size_t total = 0;
+  for (size_t idx = 0; idx < SMap::SHARD_COUNT; ++idx) {
+    auto shard = map.read_shard(idx);
+    REQUIRE(shard->count() == map.shard_count(idx));
+    REQUIRE(shard->count() > 0);
+    for (auto const &thing : *shard) {
+      REQUIRE(map.shard_for(thing._payload) == idx);
+      ++total;
+    }
+  }
+  REQUIRE(total == map.count());
+
+  // Changes through a writer update the count.
+  {
+    auto shard = map.write_shard(map.shard_for(names[0]));
+    Thing *thing = &*shard->find(names[0]);
+    shard->erase(thing);
+    delete thing;
+  }
+  REQUIRE(map.count() == total - 1);
+
+  map.apply([](Thing *thing) { delete thing; });
+  map.clear();
+  REQUIRE(map.count() == 0);
+}
+
 TEST_CASE("IntrusiveHashMap Utilities", "[IntrusiveHashMap]") {
 }
@@ -5,6 +5,10 @@
     Lexicon unit tests.
 */
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "swoc/Lexicon.h"
 #include "catch.hpp"
 
@@ -198,3 +202,38 @@ TEST_CASE("Lexicon Constructor 2", "[libts][Lexicon]")
   REQUIRE(v5["q"] == INVALID);
   REQUIRE(v5[C] == "Invalid");
 }
+
+// Expose the value map to check the bucket distribution.
+enum class Flag : uint32_t {};
+
+struct FlagLexicon : public swoc::Lexicon<Flag> {
+  using Lexicon::_by_value;
+  using ValueLinkage = Lexicon::Item::ValueLinkage;
+};
+
+TEST_CASE("Lexicon Flag Values", "[libts][Lexicon]")
+{
+  static constexpr unsigned N = 24;
+  FlagLexicon lex;
+  std::vector<std::string> names;
+  for (unsigned i = 0; i < N; ++i) {
+    names.emplace_back("flag_" + std::to_string(i));
+  }
+  for (unsigned i = 0; i < N; ++i) {
+    lex.define(Flag{1U << i}, names[i]);
+  }
+
+  for (unsigned i = 0; i < N; ++i) {
+    REQUIRE(lex[Flag{1U << i}] == names[i]);
+    REQUIRE(lex[names[i]] == Flag{1U << i});
+  }
+
+  // Flag values must be spread across the buckets, not reduced to the same few.
+  using sizing_type = decltype(lex._by_value)::sizing_type;
+  auto nb           = lex._by_value.bucket_count();
+  std::vector<unsigned> chains(nb, 0);
+  for (unsigned i = 0; i < N; ++i) {
+    ++chains[sizing_type::index(FlagLexicon::ValueLinkage::hash_of(Flag{1U << i}), nb)];
+  }
+  REQUIRE(*std::max_element(chains.begin(), chains.end()) <= 2 * ((N + nb - 1) / nb));
+}
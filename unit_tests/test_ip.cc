@@ -8,9 +8,16 @@
 #include "catch.hpp"
 
 #include <set>
+#include <array>
+#include <random>
+#include <thread>
+#include <atomic>
 
 #include "swoc/TextView.h"
 #include "swoc/swoc_ip.h"
+#include "swoc/IPSpaceView.h"
+#include "swoc/ConcurrentIPSpace.h"
+#include "swoc/IPSpaceIndex.h"
 #include "swoc/bwf_ip.h"
 #include "swoc/bwf_std.h"
 #include "swoc/swoc_file.h"
@@ -19,6 +26,7 @@
 using namespace std::literals;
 using namespace swoc::literals;
 using swoc::TextView;
+using swoc::MemSpan;
 using swoc::IPEndpoint;
 
 using swoc::IP4Addr;
@@ -1529,3 +1537,865 @@ TEST_CASE("IPSpace skew overlap blend", "[libswoc][ipspace][blend][skew]") {
     ++idx;
   }
 }
+
+TEST_CASE("IPSpace fill model", "[libswoc][ipspace][fill]") {
+  // Check @c fill against a simple per address model.
+  using Space = swoc::IPSpace<unsigned>;
+  static constexpr unsigned N = 256;
+  static constexpr uint32_t BASE = 0x0A000000;
+  std::mt19937 rng(0xf111);
+  for (unsigned round = 0; round < 20; ++round) {
+    Space space;
+    std::array<int, N> model;
+    model.fill(-1);
+    for (unsigned idx = 0; idx < 60; ++idx) {
+      uint32_t min = rng() % N;
+      uint32_t max = std::min<uint32_t>(N - 1, min + rng() % 32);
+      unsigned value = rng() % 3;
+      IPRange r{IP4Range{IP4Addr{BASE + min}, IP4Addr{BASE + max}}};
+      switch (rng() % 4) {
+      case 0:
+        space.mark(r, value);
+        std::fill(model.begin() + min, model.begin() + max + 1, int(value));
+        break;
+      case 1:
+        space.erase(r);
+        std::fill(model.begin() + min, model.begin() + max + 1, -1);
+        break;
+      default:
+        space.fill(r, value);
+        for (auto k = min; k <= max; ++k) {
+          if (model[k] < 0) {
+            model[k] = int(value);
+          }
+        }
+        break;
+      }
+      for (uint32_t k = 0; k < N; ++k) {
+        auto spot = space.find(IP4Addr{BASE + k});
+        int found = spot == space.end() ? -1 : int(std::get<1>(*spot));
+        REQUIRE(found == model[k]);
+      }
+    }
+  }
+}
+
+TEST_CASE("IPSpace erase before first range", "[libswoc][ipspace][erase]") {
+  // The erased range starts before any range in the space but overlaps the first ones.
+  swoc::IPSpace<unsigned> space;
+  space.mark(IPRange{"10.0.0.10-10.0.0.20"}, 1);
+  space.mark(IPRange{"10.0.0.30-10.0.0.40"}, 2);
+  space.erase(IPRange{"10.0.0.0-10.0.0.35"});
+  REQUIRE(space.count() == 1);
+  REQUIRE(space.find(IP4Addr{"10.0.0.15"}) == space.end());
+  REQUIRE(space.find(IP4Addr{"10.0.0.35"}) == space.end());
+  auto spot = space.find(IP4Addr{"10.0.0.36"});
+  REQUIRE(spot != space.end());
+  REQUIRE(std::get<0>(*spot) == IPRange{"10.0.0.36-10.0.0.40"});
+}
+
+TEST_CASE("IPSpace fill neighbors", "[libswoc][ipspace][fill]") {
+  swoc::IPSpace<unsigned> space;
+  space.mark(IPRange{"10.0.0.10-10.0.0.19"}, 1);
+  space.mark(IPRange{"10.0.0.30-10.0.0.39"}, 2);
+  // Fill across a neighbor with the same payload and a neighbor with a different payload.
+  space.fill(IPRange{"10.0.0.0-10.0.0.50"}, 1);
+  std::array<std::tuple<IPRange, unsigned>, 3> results = {
+    {{IPRange{"10.0.0.0-10.0.0.29"}, 1}, {IPRange{"10.0.0.30-10.0.0.39"}, 2}, {IPRange{"10.0.0.40-10.0.0.50"}, 1}}
+  };
+  REQUIRE(space.count() == results.size());
+  unsigned idx = 0;
+  for (auto const& [r, payload] : space) {
+    REQUIRE(r == std::get<0>(results[idx]));
+    REQUIRE(payload == std::get<1>(results[idx]));
+    ++idx;
+  }
+  // Fill ending inside a range with a different payload.
+  space.fill(IPRange{"10.0.0.60-10.0.0.70"}, 3);
+  space.fill(IPRange{"10.0.0.51-10.0.0.65"}, 4);
+  REQUIRE(space.count() == 5);
+  REQUIRE(std::get<0>(*space.find(IP4Addr{"10.0.0.55"})) == IPRange{"10.0.0.51-10.0.0.59"});
+  REQUIRE(std::get<1>(*space.find(IP4Addr{"10.0.0.65"})) == 3);
+}
+
+TEST_CASE("IPSpace Loader", "[libswoc][ipspace][loader]") {
+  using Space = swoc::IPSpace<unsigned>;
+  // Compare the ranges and payloads of two spaces.
+  auto same = [](Space const& lhs, Space const& rhs) -> bool {
+    if (lhs.count() != rhs.count()) {
+      return false;
+    }
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](auto const& l, auto const& r) {
+      return std::get<0>(l) == std::get<0>(r) && std::get<1>(l) == std::get<1>(r);
+    });
+  };
+
+  // Sorted and disjoint - the linear path.
+  {
+    Space space;
+    Space ref;
+    Space::Loader loader{space};
+    for (uint32_t base = 0x0A000000, value = 0; base < 0x0A100000; base += 0x100) {
+      IP4Range r{IP4Addr{base}, IP4Addr{base + 0x7F}};
+      loader.mark(r, ++value);
+      ref.mark(IPRange{r}, value);
+    }
+    REQUIRE(loader.count() == 0x1000);
+    loader.load();
+    REQUIRE(loader.count() == 0);
+    REQUIRE(same(space, ref));
+    REQUIRE(std::get<1>(*space.find(IPAddr{"10.0.3.17"})) == 4);
+    REQUIRE(space.find(IPAddr{"10.0.3.128"}) == space.end());
+  }
+
+  // Out of order, overlapping, mixed families - must match marking in the same order.
+  std::mt19937 rng(0xbeef);
+  for (unsigned n : {1, 2, 3, 7, 8, 100, 2000}) {
+    Space space;
+    Space ref;
+    Space::Loader loader{space};
+    for (unsigned idx = 0; idx < n; ++idx) {
+      uint32_t min = 0x0A000000 + uint32_t(rng() % 0x10000);
+      IPRange r{IP4Range{IP4Addr{min}, IP4Addr{min + uint32_t(rng() % 0x400)}}};
+      if (rng() % 4 == 0) {
+        W w;
+        w.print("2001:4998:{:x}::/{}", rng() % 0x40, 32 + rng() % 16);
+        r.load(w.view());
+      }
+      unsigned value = rng() % 8; // few values so coalescing happens.
+      loader.mark(r, value);
+      ref.mark(r, value);
+    }
+    loader.load();
+    REQUIRE(same(space, ref));
+
+    // Load more on top of the existing ranges, including the ends of the address space.
+    loader.mark(IPRange{IP4Range{IP4Addr::MIN, IP4Addr{"10.0.0.255"}}}, 1);
+    ref.mark(IPRange{IP4Range{IP4Addr::MIN, IP4Addr{"10.0.0.255"}}}, 1);
+    loader.mark(IPRange{IP4Range{IP4Addr{"10.0.128.0"}, IP4Addr::MAX}}, 2);
+    ref.mark(IPRange{IP4Range{IP4Addr{"10.0.128.0"}, IP4Addr::MAX}}, 2);
+    loader.mark(IPRange{"10.0.64.0/18"}, 3);
+    ref.mark(IPRange{"10.0.64.0/18"}, 3);
+    loader.load();
+    REQUIRE(same(space, ref));
+
+    // The tree must still be usable for the incremental operations.
+    for (unsigned idx = 0; idx < 200; ++idx) {
+      uint32_t min = 0x0A000000 + uint32_t(rng() % 0x10000);
+      IPRange r{IP4Range{IP4Addr{min}, IP4Addr{min + uint32_t(rng() % 0x100)}}};
+      if (idx & 1) {
+        space.erase(r);
+        ref.erase(r);
+      } else {
+        space.mark(r, idx);
+        ref.mark(r, idx);
+      }
+    }
+    REQUIRE(same(space, ref));
+    for (unsigned idx = 0; idx < 1000; ++idx) {
+      IPAddr addr{IP4Addr{in_addr_t(0x0A000000 + rng() % 0x10000)}};
+      auto spot = space.find(addr);
+      auto ref_spot = ref.find(addr);
+      REQUIRE((spot == space.end()) == (ref_spot == ref.end()));
+      if (spot != space.end()) {
+        REQUIRE(std::get<1>(*spot) == std::get<1>(*ref_spot));
+      }
+    }
+  }
+
+  // Later ranges win, even when they start at the same place.
+  {
+    Space space;
+    Space::Loader loader{space};
+    loader.mark(IPRange{"172.16.0.0/16"}, 1).mark(IPRange{"172.16.0.0/24"}, 2).mark(IPRange{"172.0.0.0/8"}, 3);
+    loader.mark(IPRange{"172.16.0.0/24"}, 3);
+    loader.load();
+    REQUIRE(space.count() == 1);
+    REQUIRE(std::get<1>(*space.find(IPAddr{"172.16.0.1"})) == 3);
+  }
+}
+
+TEST_CASE("IPSpace concurrent", "[libswoc][ipspace][concurrent]") {
+  using Space = swoc::ConcurrentIPSpace<unsigned>;
+  Space space;
+  IPRange r1{"172.16.0.0/16"};
+  IPRange r2{"2001:4998:58::/48"};
+  IPAddr a1{"172.16.3.4"};
+  IPAddr a2{"2001:4998:58:1::1"};
+
+  auto reader = space.reader();
+  {
+    auto snap = reader.snapshot();
+    REQUIRE(snap->count() == 0);
+  }
+
+  space.mark(r1, 1).mark(r2, 2);
+  {
+    auto snap = reader.snapshot();
+    REQUIRE(snap->count() == 2);
+    REQUIRE(std::get<1>(*snap->find(a1)) == 1);
+    // Later updates are not visible in an existing snapshot, and the snapshot is not reclaimed.
+    space.update([&](Space::space_type &s) {
+      s.erase(r1);
+      s.mark(IPRange{"10.0.0.0/8"}, 3);
+    });
+    REQUIRE(std::get<1>(*snap->find(a1)) == 1);
+    REQUIRE(snap->find(IPAddr{"10.1.1.1"}) == snap->end());
+    REQUIRE(space.reclaim() > 0);
+    {
+      auto nested = reader.snapshot();
+      REQUIRE(nested->find(a1) == nested->end());
+      REQUIRE(std::get<1>(*nested->find(IPAddr{"10.1.1.1"})) == 3);
+    }
+    REQUIRE(space.reclaim() > 0);
+  }
+  REQUIRE(space.reclaim() == 0);
+
+  space.fill(r1, 4).blend(r2, 2u, [](unsigned &lhs, unsigned rhs) { lhs += rhs; return true; });
+  {
+    auto snap = reader.snapshot();
+    REQUIRE(std::get<1>(*snap->find(a1)) == 4);
+    REQUIRE(std::get<1>(*snap->find(a2)) == 4);
+  }
+  space.clear();
+  REQUIRE(reader.snapshot()->count() == 0);
+
+  // Readers see only complete updates while a writer is running. Every range in a published
+  // space has the same payload, so a reader can check consistency.
+  static constexpr unsigned N_READERS = 4;
+  static constexpr unsigned N_UPDATES = 200;
+  std::atomic<bool> done_p{false};
+  std::atomic<unsigned> errors{0};
+  std::vector<std::thread> threads;
+  for (unsigned idx = 0; idx < N_READERS; ++idx) {
+    threads.emplace_back([&]() {
+      auto rd = space.reader();
+      while (!done_p.load()) {
+        auto snap = rd.snapshot();
+        if (snap->count() == 0) {
+          continue;
+        }
+        auto value = std::get<1>(*snap->begin());
+        for (auto const &[range, payload] : *snap) {
+          if (payload != value) {
+            ++errors;
+          }
+        }
+        if (auto spot = snap->find(a1); spot == snap->end() || std::get<1>(*spot) != value) {
+          ++errors;
+        }
+      }
+    });
+  }
+  for (unsigned value = 1; value <= N_UPDATES; ++value) {
+    space.update([=](Space::space_type &s) {
+      for (auto const &[range, payload] : s) {
+        payload = value;
+      }
+      for (uint32_t base = 0xAC100000; base < 0xAC110000; base += 0x1000) {
+        s.mark(IPRange{IP4Range{IP4Addr{base}, IP4Addr{base + 0x7FF}}}, value);
+      }
+    });
+  }
+  done_p = true;
+  for (auto &t : threads) {
+    t.join();
+  }
+  REQUIRE(errors == 0);
+  REQUIRE(space.reclaim() == 0);
+}
+
+TEST_CASE("IPSpace find_batch", "[libswoc][ipspace][batch]") {
+  using Space = swoc::IPSpace<unsigned>;
+  Space space;
+  std::mt19937 rng(0xba7c);
+  unsigned value = 0;
+  for (uint32_t base = 0x0A000000; base < 0x0A100000; base += 0x100) {
+    uint32_t offset = rng() % 0x40;
+    space.mark(IPRange{IP4Range{IP4Addr{base + offset}, IP4Addr{base + 0x80 + offset}}}, ++value);
+  }
+  for (unsigned idx = 0; idx < 500; ++idx) {
+    W w;
+    w.print("2001:4998:58:{:x}::/64", 2 * idx + (rng() % 2));
+    space.mark(IPRange{w.view()}, ++value);
+  }
+
+  // Mixed families, misses, and invalid addresses, in a count that is not a multiple of the group.
+  std::vector<IPAddr> addrs;
+  for (unsigned idx = 0; idx < 1000; ++idx) {
+    switch (rng() % 5) {
+    case 0: {
+      W w;
+      w.print("2001:4998:58:{:x}::{:x}", rng() % 1100, rng() % 0x10000);
+      addrs.emplace_back(w.view());
+    } break;
+    case 1:
+      addrs.emplace_back();
+      break;
+    default:
+      addrs.emplace_back(IP4Addr{in_addr_t(0x09F00000 + rng() % 0x200000)});
+      break;
+    }
+  }
+  std::vector<Space::iterator> results(addrs.size());
+  space.find_batch(MemSpan<IPAddr const>{addrs.data(), addrs.size()}, MemSpan<Space::iterator>{results.data(), results.size()});
+  unsigned hits = 0;
+  for (size_t idx = 0; idx < addrs.size(); ++idx) {
+    auto spot = space.find(addrs[idx]);
+    REQUIRE(spot == results[idx]);
+    if (spot != space.end()) {
+      ++hits;
+    }
+  }
+  REQUIRE(hits > 0);
+  REQUIRE(hits < addrs.size());
+
+  Space const& cspace = space;
+  std::vector<Space::const_iterator> cresults(addrs.size());
+  cspace.find_batch(MemSpan<IPAddr const>{addrs.data(), addrs.size()}, MemSpan<Space::const_iterator>{cresults.data(), cresults.size()});
+  for (size_t idx = 0; idx < addrs.size(); ++idx) {
+    REQUIRE(cresults[idx] == cspace.find(addrs[idx]));
+  }
+
+  // Empty space.
+  Space empty;
+  empty.find_batch(MemSpan<IPAddr const>{addrs.data(), addrs.size()}, MemSpan<Space::iterator>{results.data(), results.size()});
+  REQUIRE(std::all_of(results.begin(), results.end(), [&](auto const& spot) { return spot == empty.end(); }));
+}
+
+TEST_CASE("IPSpace IP4Index", "[libswoc][ipspace][index]") {
+  using Space = swoc::IPSpace<unsigned>;
+  Space space;
+  swoc::IP4Index<unsigned> index;
+
+  REQUIRE(index.find(IP4Addr{"10.0.0.1"}) == nullptr);
+  index.rebuild(space);
+  REQUIRE(index.count() == 0);
+  REQUIRE(index.find(IP4Addr{"10.0.0.1"}) == nullptr);
+
+  std::mt19937 rng(0x2408);
+  unsigned value = 0;
+  // Mix of ranges within a /24, spanning /24 boundaries, and covering many /24s.
+  for (uint32_t base = 0x0A000000; base < 0x0B000000; base += 0x10000 + rng() % 0x1000) {
+    uint32_t min  = base + rng() % 0x200;
+    uint32_t size = (rng() % 3 == 0) ? 0x2000 + uint32_t(rng() % 0x4000) : uint32_t(rng() % 0x180);
+    space.mark(IPRange{IP4Range{IP4Addr{min}, IP4Addr{min + size}}}, ++value);
+  }
+  // Single addresses sharing a /24.
+  for (uint32_t host = 0x0C000001; host < 0x0C0000F0; host += 2 + rng() % 4) {
+    space.mark(IPRange{IP4Range{IP4Addr{host}, IP4Addr{host}}}, ++value);
+  }
+  // Edges of the address space.
+  space.mark(IPRange{IP4Range{IP4Addr::MIN, IP4Addr{"0.0.1.7"}}}, ++value);
+  space.mark(IPRange{IP4Range{IP4Addr{"255.255.254.9"}, IP4Addr::MAX}}, ++value);
+  space.mark(IPRange{"2001:4998:58::/48"}, ++value);
+
+  index.rebuild(space);
+  REQUIRE(index.count() == space.count_ip4());
+  REQUIRE(index.group_count() > 0);
+
+  auto check = [&](IP4Addr const& addr) -> bool {
+    auto spot = space.find(addr);
+    auto p    = index.find(addr);
+    if (spot == space.end()) {
+      return p == nullptr && index.index(addr) == index.INVALID;
+    }
+    return p != nullptr && *p == std::get<1>(*spot) && index.payload(index.index(addr)) == *p;
+  };
+  for (auto spot = space.begin_ip4(); spot != space.end_ip4(); ++spot) {
+    auto const& range = std::get<0>(*spot).ip4();
+    REQUIRE(check(range.min()));
+    REQUIRE(check(range.max()));
+    REQUIRE(check(--IP4Addr{range.min()}));
+    REQUIRE(check(++IP4Addr{range.max()}));
+  }
+  for (unsigned idx = 0; idx < 100000; ++idx) {
+    REQUIRE(check(IP4Addr{in_addr_t(0x09F00000 + rng() % 0x2200000)}));
+  }
+  REQUIRE(*index.find(IPAddr{"0.0.0.0"}) == value - 2);
+  REQUIRE(*index.find(IPAddr{"255.255.255.255"}) == value - 1);
+  REQUIRE(index.find(IPAddr{"2001:4998:58::1"}) == nullptr);
+
+  // Rebuild after a change.
+  space.mark(IPRange{"10.0.0.0/8"}, 0);
+  index.rebuild(space);
+  REQUIRE(*index.find(IP4Addr{"10.99.1.2"}) == 0);
+  REQUIRE(check(IP4Addr{"11.0.0.0"}));
+
+  index.clear();
+  REQUIRE(index.find(IP4Addr{"10.99.1.2"}) == nullptr);
+}
+
+TEST_CASE("IPSpace IP6Index", "[libswoc][ipspace][index]") {
+  using Space = swoc::IPSpace<unsigned>;
+  Space space;
+  swoc::IP6Index<unsigned> index;
+
+  REQUIRE(index.find(IP6Addr{"2001::1"}) == nullptr);
+  index.rebuild(space);
+  REQUIRE(index.count() == 0);
+  REQUIRE(index.find(IP6Addr{"2001::1"}) == nullptr);
+
+  std::mt19937 rng(0x1286);
+  unsigned value = 0;
+  // Prefix aligned ranges of the common lengths.
+  for (unsigned idx = 0; idx < 200; ++idx) {
+    W w;
+    w.print("2001:{:x}:{:x}:{:x}::/{}", rng() % 0x100, rng() % 0x10, rng() % 0x10, std::array<unsigned, 4>{32, 48, 56, 64}[rng() % 4]);
+    space.mark(IPRange{w.view()}, ++value);
+  }
+  // Unaligned ranges.
+  for (unsigned idx = 0; idx < 200; ++idx) {
+    W w;
+    auto a = rng() % 0x10;
+    auto b = rng() % 0xFF00;
+    w.print("2600:{:x}:{:x}::{:x}-2600:{:x}:{:x}::{:x}", a, b, rng() % 0x10000, a, b + 1 + rng() % 0x10, rng() % 0x10000);
+    space.mark(IPRange{w.view()}, ++value);
+  }
+  // Edges of the address space.
+  space.mark(IPRange{"::-::1:2:3"}, ++value);
+  space.mark(IPRange{"ffff:ffff::1-ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"}, ++value);
+  space.mark(IPRange{"10.0.0.0/8"}, ++value);
+
+  index.rebuild(space);
+  REQUIRE(index.count() == space.count_ip6());
+  REQUIRE(index.node_count() > 0);
+
+  auto check = [&](IP6Addr const& addr) -> bool {
+    auto spot = space.find(addr);
+    auto p    = index.find(addr);
+    if (spot == space.end()) {
+      return p == nullptr && index.index(addr) == index.INVALID;
+    }
+    return p != nullptr && *p == std::get<1>(*spot) && index.payload(index.index(addr)) == *p;
+  };
+  for (auto spot = space.begin_ip6(); spot != space.end_ip6(); ++spot) {
+    auto const& range = std::get<0>(*spot).ip6();
+    REQUIRE(check(range.min()));
+    REQUIRE(check(range.max()));
+    if (range.min() != IP6Addr::MIN) {
+      REQUIRE(check(--IP6Addr{range.min()}));
+    }
+    if (range.max() != IP6Addr::MAX) {
+      REQUIRE(check(++IP6Addr{range.max()}));
+    }
+  }
+  for (unsigned idx = 0; idx < 20000; ++idx) {
+    W w;
+    w.print("{}:{:x}:{:x}::{:x}", idx & 1 ? "2001" : "2600", rng() % 0x100, rng() % 0x10000, rng() % 0x10000);
+    REQUIRE(check(IP6Addr{w.view()}));
+  }
+  REQUIRE(*index.find(IPAddr{"::"}) == value - 2);
+  REQUIRE(*index.find(IPAddr{"ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"}) == value - 1);
+  REQUIRE(index.find(IPAddr{"10.1.1.1"}) == nullptr);
+
+  index.clear();
+  REQUIRE(index.find(IP6Addr{"::"}) == nullptr);
+}
+
+TEST_CASE("IPSpace set operations", "[libswoc][ipspace][merge]") {
+  using Space = swoc::IPSpace<unsigned>;
+  static constexpr unsigned N = 512;
+  static constexpr uint32_t BASE = 0x0A000000;
+  std::mt19937 rng(0x5e7);
+  // Compare the ranges and payloads of two spaces.
+  auto same = [](Space const& lhs, Space const& rhs) -> bool {
+    return lhs.count() == rhs.count() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](auto const& l, auto const& r) {
+             return std::get<0>(l) == std::get<0>(r) && std::get<1>(l) == std::get<1>(r);
+           });
+  };
+  // Random space and per address model.
+  auto generate = [&](Space& space, std::array<int, N>& model) {
+    model.fill(-1);
+    for (unsigned idx = 0, n = rng() % 40; idx < n; ++idx) {
+      uint32_t min = rng() % N;
+      uint32_t max = std::min<uint32_t>(N - 1, min + rng() % 40);
+      unsigned value = 1 + rng() % 3;
+      space.mark(IPRange{IP4Range{IP4Addr{BASE + min}, IP4Addr{BASE + max}}}, value);
+      std::fill(model.begin() + min, model.begin() + max + 1, int(value));
+    }
+    if (rng() % 2) { // make sure the ends are covered sometimes.
+      space.mark(IPRange{IP4Range{IP4Addr{BASE}, IP4Addr{BASE + 3}}}, 1);
+      std::fill(model.begin(), model.begin() + 4, 1);
+    }
+    space.mark(IPRange{"2001:4998::/32"}, 1);
+  };
+  auto check = [&](Space& space, std::array<int, N> const& model) -> bool {
+    for (uint32_t k = 0; k < N; ++k) {
+      auto spot = space.find(IP4Addr{BASE + k});
+      if ((spot == space.end() ? -1 : int(std::get<1>(*spot))) != model[k]) {
+        return false;
+      }
+    }
+    return true;
+  };
+  // Combine by adding, drop the result if it is 5.
+  auto combiner = [](unsigned& lhs, unsigned const& rhs) -> bool {
+    lhs += rhs;
+    return lhs != 5;
+  };
+
+  for (unsigned round = 0; round < 100; ++round) {
+    Space a, b;
+    std::array<int, N> ma, mb, expect;
+    generate(a, ma);
+    generate(b, mb);
+
+    Space r;
+    r.merge(a);
+    REQUIRE(same(r, a));
+
+    Space ref; // reference using the incremental operations.
+    ref.merge(a);
+    for (auto const& [range, payload] : b) {
+      ref.mark(range, payload);
+    }
+    r.merge(b);
+    REQUIRE(same(r, ref));
+
+    r.clear();
+    r.merge(a).merge(b, combiner);
+    for (unsigned k = 0; k < N; ++k) {
+      expect[k] = ma[k] < 0 ? mb[k] : mb[k] < 0 ? ma[k] : (ma[k] + mb[k] == 5 ? -1 : ma[k] + mb[k]);
+    }
+    REQUIRE(check(r, expect));
+    REQUIRE(std::get<1>(*r.find(IPAddr{"2001:4998::1"})) == 2);
+
+    r.clear();
+    r.merge(a).intersect(b);
+    for (unsigned k = 0; k < N; ++k) {
+      expect[k] = ma[k] < 0 || mb[k] < 0 ? -1 : ma[k];
+    }
+    REQUIRE(check(r, expect));
+
+    r.clear();
+    r.merge(a).intersect(b, combiner);
+    for (unsigned k = 0; k < N; ++k) {
+      expect[k] = ma[k] < 0 || mb[k] < 0 || ma[k] + mb[k] == 5 ? -1 : ma[k] + mb[k];
+    }
+    REQUIRE(check(r, expect));
+
+    r.clear();
+    ref.clear();
+    r.merge(a).subtract(b);
+    ref.merge(a);
+    for (auto const& [range, payload] : b) {
+      ref.erase(range);
+    }
+    REQUIRE(same(r, ref));
+    REQUIRE(r.count_ip6() == 0);
+  }
+}
+
+TEST_CASE("IPSpace diff", "[libswoc][ipspace][diff]") {
+  using Space = swoc::IPSpace<unsigned>;
+  struct Delta {
+    IPRange _range;
+    int _prev;
+    int _next;
+  };
+  std::vector<Delta> deltas;
+  auto collect = [&](IPRange const& range, unsigned const *prev, unsigned const *next) {
+    deltas.push_back(Delta{range, prev ? int(*prev) : -1, next ? int(*next) : -1});
+  };
+
+  Space prev, next;
+  Space::diff(prev, next, collect);
+  REQUIRE(deltas.empty());
+
+  for (uint32_t base = 0x0A000000, value = 0; base < 0x0A100000; base += 0x100) {
+    prev.mark(IPRange{IP4Range{IP4Addr{base}, IP4Addr{base + 0x7F}}}, ++value);
+  }
+  prev.mark(IPRange{"2001:4998:58::/48"}, 1);
+  next.merge(prev);
+  Space::diff(prev, next, collect);
+  REQUIRE(deltas.empty());
+
+  next.mark(IPRange{"10.0.3.0/25"}, 1000);          // changed.
+  next.erase(IPRange{"10.0.5.0/24"});               // removed.
+  next.mark(IPRange{"10.0.6.128-10.0.6.255"}, 7);   // added, adjacent and same as prior range.
+  next.mark(IPRange{"2001:4998:59::/48"}, 2);       // added.
+  Space::diff(prev, next, collect);
+  REQUIRE(deltas.size() == 4);
+  REQUIRE(deltas[0]._range == IPRange{"10.0.3.0-10.0.3.127"});
+  REQUIRE(deltas[0]._prev == 4);
+  REQUIRE(deltas[0]._next == 1000);
+  REQUIRE(deltas[1]._range == IPRange{"10.0.5.0-10.0.5.127"});
+  REQUIRE(deltas[1]._prev == 6);
+  REQUIRE(deltas[1]._next == -1);
+  REQUIRE(deltas[2]._range == IPRange{"10.0.6.128-10.0.6.255"});
+  REQUIRE(deltas[2]._prev == -1);
+  REQUIRE(deltas[2]._next == 7);
+  REQUIRE(deltas[3]._range == IPRange{"2001:4998:59::/48"});
+  REQUIRE(deltas[3]._prev == -1);
+  REQUIRE(deltas[3]._next == 2);
+
+  // Applying the deltas to the previous space must yield the next space.
+  for (auto const& d : deltas) {
+    if (d._next < 0) {
+      prev.erase(d._range);
+    } else {
+      prev.mark(d._range, unsigned(d._next));
+    }
+  }
+  deltas.clear();
+  Space::diff(prev, next, collect);
+  REQUIRE(deltas.empty());
+}
+
+TEST_CASE("IPSpace compact", "[libswoc][ipspace][compact]") {
+  using Space = swoc::IPSpace<unsigned>;
+  Space space;
+  for (uint32_t base = 0x0A000000, value = 0; base < 0x0A010000; base += 0x100) {
+    space.mark(IPRange{IP4Range{IP4Addr{base}, IP4Addr{base + 0xFF}}}, ++value);
+  }
+  space.mark(IPRange{"2001:4998:58::/48"}, 1).mark(IPRange{"2001:4998:59::/48"}, 2);
+  REQUIRE(space.count() == 258);
+  // Updating payloads in place leaves equal payloads in adjacent ranges.
+  for (auto&& [range, payload] : space) {
+    payload /= 16;
+  }
+  REQUIRE(space.count() == 258);
+  space.compact();
+  REQUIRE(space.count() == 18);
+  REQUIRE(std::get<1>(*space.find(IPAddr{"10.0.0.1"})) == 0);
+  REQUIRE(std::get<0>(*space.find(IPAddr{"10.0.0.1"})) == IPRange{"10.0.0.0-10.0.14.255"});
+  REQUIRE(std::get<0>(*space.find(IPAddr{"10.0.20.1"})) == IPRange{"10.0.15.0-10.0.30.255"});
+  REQUIRE(std::get<0>(*space.find(IPAddr{"2001:4998:58::1"})) == IPRange{"2001:4998:58::-2001:4998:59:ffff:ffff:ffff:ffff:ffff"});
+  // Still a valid tree.
+  space.erase(IPRange{"10.0.16.0/20"});
+  REQUIRE(space.find(IPAddr{"10.0.20.1"}) == space.end());
+  REQUIRE(std::get<1>(*space.find(IPAddr{"10.0.15.1"})) == 1);
+
+  // Payload without @c operator== using only some members for equality.
+  struct Payload {
+    unsigned _value;
+    unsigned _hits;
+  };
+  struct Equal {
+    bool operator()(Payload const& lhs, Payload const& rhs) const { return lhs._value == rhs._value; }
+  };
+  swoc::DiscreteSpace<IP4Addr, Payload, Equal> dspace;
+  dspace.mark({IP4Addr{"10.0.0.0"}, IP4Addr{"10.0.0.255"}}, Payload{1, 0});
+  dspace.mark({IP4Addr{"10.0.1.0"}, IP4Addr{"10.0.1.255"}}, Payload{1, 5});
+  dspace.mark({IP4Addr{"10.0.2.0"}, IP4Addr{"10.0.2.255"}}, Payload{2, 5});
+  REQUIRE(dspace.count() == 2);
+  dspace.begin()->payload()._value = 2;
+  REQUIRE(dspace.count() == 2);
+  dspace.compact();
+  REQUIRE(dspace.count() == 1);
+  REQUIRE(dspace.find(IP4Addr{"10.0.2.1"})->payload()._value == 2);
+}
+
+TEST_CASE("IPSpace equality policy", "[libswoc][ipspace][compact]") {
+  // Payload without @c operator== using only some members for equality.
+  struct Payload {
+    unsigned _value;
+    unsigned _hits;
+  };
+  struct Equal {
+    bool operator()(Payload const& lhs, Payload const& rhs) const { return lhs._value == rhs._value; }
+  };
+  using Space = swoc::IPSpace<Payload, Equal>;
+
+  Space space;
+  space.mark(IPRange{"10.0.0.0/24"}, Payload{1, 0});
+  space.mark(IPRange{"10.0.1.0/24"}, Payload{1, 5});
+  space.fill(IPRange{"10.0.2.0/24"}, Payload{1, 7});
+  space.mark(IPRange{"10.0.3.0/24"}, Payload{2, 0});
+  space.mark(IPRange{"2001:4998:58::/48"}, Payload{1, 0});
+  space.mark(IPRange{"2001:4998:59::/48"}, Payload{1, 3});
+  REQUIRE(space.count() == 3);
+  REQUIRE(std::get<0>(*space.find(IPAddr{"10.0.1.1"})) == IPRange{"10.0.0.0-10.0.2.255"});
+  REQUIRE(std::get<1>(*space.find(IPAddr{"10.0.3.1"}))._value == 2);
+
+  // Payloads updated in place are merged by @c compact.
+  std::get<1>(*space.find(IPAddr{"10.0.0.1"}))._value = 2;
+  space.compact();
+  REQUIRE(space.count() == 2);
+
+  Space loaded;
+  Space::Loader loader{loaded};
+  loader.mark(IPRange{"10.0.0.0/22"}, Payload{2, 1});
+  loader.mark(IPRange{"10.0.4.0/24"}, Payload{2, 1});
+  loader.mark(IPRange{"2001:4998:58::/47"}, Payload{1, 9});
+  loader.load();
+  REQUIRE(loaded.count() == 2);
+
+  // Same payload values in the same ranges, differences only in @a _hits are ignored.
+  unsigned n_diff = 0;
+  Space::diff(space, space, [&](IPRange const&, Payload const *, Payload const *) { ++n_diff; });
+  REQUIRE(n_diff == 0);
+  Space::diff(space, loaded, [&](IPRange const& range, Payload const *lhs, Payload const *rhs) {
+    ++n_diff;
+    REQUIRE(range == IPRange{"10.0.4.0/24"});
+    REQUIRE(lhs == nullptr);
+    REQUIRE(rhs != nullptr);
+  });
+  REQUIRE(n_diff == 1);
+
+  space.merge(loaded);
+  REQUIRE(space.count() == 2);
+  REQUIRE(std::get<0>(*space.find(IPAddr{"10.0.2.1"})) == IPRange{"10.0.0.0-10.0.4.255"});
+  space.subtract(loaded);
+  REQUIRE(space.count() == 0);
+  REQUIRE(space.find(IPAddr{"10.0.2.1"}) == space.end());
+
+  auto view = loaded.freeze();
+  REQUIRE(view.count() == 2);
+  REQUIRE(view.find(IPAddr{"10.0.4.1"})->_value == 2);
+  swoc::IP4Index<Payload> index4{loaded};
+  REQUIRE(index4.find(IP4Addr{"10.0.4.1"})->_value == 2);
+  swoc::IP6Index<Payload> index6{loaded};
+  REQUIRE(index6.find(IP6Addr{"2001:4998:59::1"})->_hits == 9);
+
+  swoc::ConcurrentIPSpace<Payload, Equal> cspace;
+  cspace.mark(IPRange{"10.0.0.0/24"}, Payload{1, 0}).mark(IPRange{"10.0.1.0/24"}, Payload{1, 1});
+  REQUIRE(cspace.reader().snapshot()->count() == 1);
+}
+
+TEST_CASE("IPSpace freeze", "[libswoc][ipspace][view]") {
+  using Space = swoc::IPSpace<unsigned>;
+  Space space;
+
+  // Empty space.
+  {
+    auto view = space.freeze();
+    REQUIRE(view.count() == 0);
+    REQUIRE(view.find(IPAddr{"172.16.0.1"}) == nullptr);
+    REQUIRE(view.find(IPAddr{"::1"}) == nullptr);
+  }
+
+  // Lots of disjoint ranges with gaps, so misses are checked as well as hits.
+  std::mt19937 rng(0x1337);
+  unsigned value = 0;
+  for (uint32_t base = 0x0A000000; base < 0x0A010000; base += 0x100) {
+    uint32_t offset = rng() % 0x40;
+    space.mark(IPRange{IP4Range{IP4Addr{base + offset}, IP4Addr{base + 0x80 + offset}}}, ++value);
+  }
+  for (unsigned idx = 0; idx < 100; ++idx) {
+    W w;
+    w.print("2001:4998:58:{:x}::/64", 2 * idx + (rng() % 2));
+    space.mark(IPRange{w.view()}, ++value);
+  }
+  // Edge ranges.
+  space.mark(IPRange{IP4Range{IP4Addr::MIN, IP4Addr{"0.0.0.255"}}}, ++value);
+  space.mark(IPRange{IP4Range{IP4Addr{"255.255.255.0"}, IP4Addr::MAX}}, ++value);
+
+  auto view = space.freeze();
+  REQUIRE(view.count() == space.count());
+  REQUIRE(view.count_ip4() == space.count_ip4());
+  REQUIRE(view.count_ip6() == space.count_ip6());
+
+  // Every range boundary and the addresses adjacent to them must match the space.
+  auto check = [&](IPAddr const& addr) -> bool {
+    auto spot = space.find(addr);
+    auto p    = view.find(addr);
+    if (spot == space.end()) {
+      return p == nullptr;
+    }
+    return p != nullptr && *p == std::get<1>(*spot);
+  };
+  for (auto const& [range, payload] : space) {
+    auto min = range.min();
+    auto max = range.max();
+    REQUIRE(*view.find(min) == payload);
+    REQUIRE(*view.find(max) == payload);
+    if (min.is_ip4()) {
+      REQUIRE(check(IPAddr{--IP4Addr{min.ip4()}}));
+      REQUIRE(check(IPAddr{++IP4Addr{max.ip4()}}));
+    } else {
+      REQUIRE(check(IPAddr{--IP6Addr{min.ip6()}}));
+      REQUIRE(check(IPAddr{++IP6Addr{max.ip6()}}));
+    }
+  }
+  for (unsigned idx = 0; idx < 10000; ++idx) {
+    IPAddr addr{IP4Addr{in_addr_t(0x0A000000 + (rng() & 0xFFFF))}};
+    REQUIRE(check(addr));
+  }
+  REQUIRE(view.find(IPAddr{"10.2.0.0"}) == nullptr);
+  REQUIRE(view.find(IPAddr{"2001:4998:58:401::"}) == nullptr);
+  REQUIRE(*view.find(IP4Addr{"0.0.0.0"}) == value - 1);
+  REQUIRE(*view.find(IP4Addr{"255.255.255.255"}) == value);
+
+  // The view is independent of the space.
+  space.clear();
+  REQUIRE(*view.find(IP4Addr{"0.0.0.17"}) == value - 1);
+
+  // Move.
+  decltype(view) view2{std::move(view)};
+  REQUIRE(view.count() == 0);
+  REQUIRE(view.find(IP4Addr{"0.0.0.17"}) == nullptr);
+  REQUIRE(*view2.find(IP4Addr{"0.0.0.17"}) == value - 1);
+}
+
+TEST_CASE("IPSpace file", "[libswoc][ipspace][view][file]") {
+  using Space = swoc::IPSpace<unsigned>;
+  using View  = swoc::IPSpaceView<unsigned>;
+  swoc::file::path path{"/tmp/swoc_ipspace_view.dat"};
+  static constexpr uint64_t TAG = 0x5ca1ab1e;
+
+  Space space;
+  unsigned value = 0;
+  for (uint32_t base = 0x0A000000; base < 0x0A100000; base += 0x100) {
+    space.mark(IPRange{IP4Range{IP4Addr{base}, IP4Addr{base + 0x7F}}}, ++value);
+  }
+  for (unsigned idx = 0; idx < 1000; ++idx) {
+    W w;
+    w.print("2001:4998:{:x}::/48", 3 * idx);
+    space.mark(IPRange{w.view()}, ++value);
+  }
+
+  {
+    auto view = space.freeze();
+    auto errata = view.store(path, TAG);
+    REQUIRE(errata.is_ok());
+  }
+
+  View view;
+  REQUIRE(view.map(path, TAG).is_ok());
+  REQUIRE(view.count_ip4() == space.count_ip4());
+  REQUIRE(view.count_ip6() == space.count_ip6());
+  for (auto const& [range, payload] : space) {
+    REQUIRE(view.find(range.min()) != nullptr);
+    REQUIRE(*view.find(range.min()) == payload);
+    REQUIRE(*view.find(range.max()) == payload);
+  }
+  REQUIRE(view.find(IPAddr{"10.0.0.128"}) == nullptr);
+  REQUIRE(view.find(IPAddr{"2001:4998:1::"}) == nullptr);
+  REQUIRE(view.find(IPAddr{"172.16.0.1"}) == nullptr);
+
+  // Mismatched schema tag.
+  View bad_view;
+  REQUIRE_FALSE(bad_view.map(path, TAG + 1).is_ok());
+  REQUIRE(bad_view.count() == 0);
+  // Mismatched payload layout.
+  REQUIRE_FALSE(swoc::IPSpaceView<uint64_t>().map(path, TAG).is_ok());
+  // Not the right kind of file.
+  REQUIRE_FALSE(bad_view.map(swoc::file::path{"unit_tests/test_ip.cc"}, TAG).is_ok());
+  // Truncated file.
+  std::error_code ec;
+  auto fsize = swoc::file::file_size(swoc::file::status(path, ec));
+  REQUIRE(0 == ::truncate(path.c_str(), fsize / 2));
+  REQUIRE_FALSE(bad_view.map(path, TAG).is_ok());
+
+  // Empty space, empty payload.
+  swoc::IPSpace<std::monostate> set;
+  REQUIRE(set.freeze().store(path).is_ok());
+  swoc::IPSpaceView<std::monostate> set_view;
+  REQUIRE(set_view.map(path).is_ok());
+  REQUIRE(set_view.count() == 0);
+  REQUIRE(set_view.find(IPAddr{"172.16.0.1"}) == nullptr);
+
+  set.mark(IPRange{"172.16.0.0/16"}, std::monostate{});
+  set.mark(IPRange{"1337::/32"}, std::monostate{});
+  REQUIRE(set.freeze().store(path).is_ok());
+  REQUIRE(set_view.map(path).is_ok());
+  REQUIRE(set_view.count() == 2);
+  REQUIRE(set_view.find(IPAddr{"172.16.3.1"}) != nullptr);
+  REQUIRE(set_view.find(IPAddr{"172.17.3.1"}) == nullptr);
+  REQUIRE(set_view.find(IPAddr{"1337::ded:beef"}) != nullptr);
+
+  ::unlink(path.c_str());
+}